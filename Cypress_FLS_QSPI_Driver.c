@@ -20,40 +20,497 @@
 */
 
 #include "Cypress_FLS_QSPI_Driver.h"
+#include <stddef.h>
+
+/* Private variables */
+// Continuous read session: 0 = idle, 1 = begun, 2 = flash is in continuous read mode
+static uint8_t continuousReadState = 0;
+// Timing used by all reads, starts from the QSPI_DUMMY defaults and is updated by Cypress_QSPI_ApplyTimingProfile
+// The prescaler and sample shift are synced from the handle by Cypress_QSPI_GetTimingProfile
+static Cypress_QSPI_TimingProfile activeTiming =
+{
+    .ClockPrescaler     = 0,
+    .SampleShifting     = QSPI_SAMPLE_SHIFTING_NONE,
+    .DdrHoldHalfCycle   = CYPRESS_DDR_HOLD_HALF_CYCLE,
+    .LatencyCode        = CYPRESS_DUMMY_LC,
+    .DummyFastRead      = CYPRESS_DUMMY_CLOCK_CYCLES_FASTREAD,
+    .DummyDual          = CYPRESS_DUMMY_CLOCK_CYCLES_READ_DUAL,
+    .DummyDualIO        = CYPRESS_DUMMY_CLOCK_CYCLES_READ_DUALIO,
+    .DummyQuad          = CYPRESS_DUMMY_CLOCK_CYCLES_READ_QUAD,
+    .DummyQuadIO        = CYPRESS_DUMMY_CLOCK_CYCLES_READ_QUADIO,
+    .DummyFastReadDDR   = CYPRESS_DUMMY_CLOCK_CYCLES_FASTREAD_DDR,
+    .DummyQuadIODDR     = CYPRESS_DUMMY_CLOCK_CYCLES_READ_QUADIO_DDR,
+};
+
+#if (USE_HAL_QSPI_REGISTER_CALLBACKS == 1)
+// Streaming read, driven from the RxCplt callback
+static struct
+{
+    Cypress_QSPI_ChunkCallback Callback;
+    pQSPI_CallbackTypeDef SavedRxCplt;
+    pQSPI_CallbackTypeDef SavedError;
+    uint8_t *Buffer[2];
+    uint32_t Address;       // Address of the chunk in flight
+    uint32_t Remaining;     // Bytes not yet completed, including the chunk in flight
+    uint32_t ChunkSize;
+    uint32_t Pending;       // Size of the chunk in flight
+    uint8_t Active;         // Buffer receiving the chunk in flight
+    HAL_StatusTypeDef Status;
+} stream = { .Status = HAL_OK };
+// Scatter-gather read, chained from the RxCplt callback
+static struct
+{
+    const Cypress_QSPI_ReadDescriptor *Vector;
+    uint32_t Length;
+    uint32_t Index;         // Descriptor in flight
+    Cypress_QSPI_CompleteCallback Callback;
+    pQSPI_CallbackTypeDef SavedRxCplt;
+    pQSPI_CallbackTypeDef SavedError;
+    HAL_StatusTypeDef Status;
+} readV = { .Status = HAL_OK };
+// Pipelined range program, driven from the TxCplt and StatusMatch callbacks
+static struct
+{
+    uint32_t Address;       // Address of the page in flight
+    uint8_t *Src;
+    uint32_t Remaining;     // Bytes not yet programmed, including the page in flight
+    uint32_t Pending;       // Size of the page in flight
+    Cypress_QSPI_CompleteCallback Callback;
+    pQSPI_CallbackTypeDef SavedTxCplt;
+    pQSPI_CallbackTypeDef SavedStatusMatch;
+    pQSPI_CallbackTypeDef SavedError;
+    HAL_StatusTypeDef Status;
+} programEngine = { .Status = HAL_OK };
+// Suspendable sector erase, flagged from the StatusMatch callback and advanced by Cypress_QSPI_EraseManagerStep
+static struct
+{
+    uint32_t Sector;        // Address of the block being erased
+    uint32_t SectorSize;    // Size of the block being erased
+    uint32_t Next;          // Address of the next block to erase
+    uint32_t End;           // Address after the last block to erase
+    uint32_t Done;          // Bytes erased so far
+    uint32_t Total;         // Bytes to erase
+    uint32_t ParamStart;    // Address of the first parameter sector
+    uint8_t Bulk;           // Erasing the whole array
+    uint32_t LastResume;    // HAL tick the block started or was last resumed
+    uint32_t SuspendStart;  // HAL tick of the current suspend
+    volatile uint8_t BlockDone; // Set from the interrupt once WIP clears on the block being erased
+    struct
+    {
+        uint32_t Address;
+        uint8_t *Source;
+        uint32_t Count;
+    } Queue[CYPRESS_ERASE_PROGRAM_QUEUE];   // Programs waiting for the erase to be suspended
+    uint8_t Queued;
+    Cypress_QSPI_ProgressCallback Progress;
+    Cypress_QSPI_CompleteCallback Callback;
+    pQSPI_CallbackTypeDef SavedStatusMatch;
+    pQSPI_CallbackTypeDef SavedError;
+    Cypress_QSPI_EraseStats Stats;
+    volatile HAL_StatusTypeDef Status;
+} eraseManager = { .Status = HAL_OK };
+// Sectors kept erased in the background, see Cypress_QSPI_PoolInit
+#define POOL_MAX_SECTORS                      (CYPRESS_FLASH_SIZE / CYPRESS_SECTOR_SIZE)
+#define POOL_NONE                             0xFFFFFFFF
+static struct
+{
+    uint32_t Start;         // Address of the first pool sector
+    uint32_t Count;         // Sectors in the pool
+    uint32_t Target;        // Erased sectors to keep ready
+    uint32_t LowWatermark;  // Erased count below which a claim calls Callback
+    uint32_t Cursor;        // Index to start the next search for a dirty sector
+    volatile uint32_t Pending;  // Index being erased, or POOL_NONE
+    uint8_t Erased[(POOL_MAX_SECTORS + 7) / 8];     // Bit per sector, set once known to be erased
+    uint8_t InUse[(POOL_MAX_SECTORS + 7) / 8];      // Bit per sector, set while claimed
+    Cypress_QSPI_PoolCallback Callback;
+    Cypress_QSPI_PoolStats Stats;
+} pool = { .Pending = POOL_NONE };
+#endif
+
+#if (CYPRESS_CACHE_LINES > 0)
+// Read cache, CYPRESS_CACHE_LINES / CYPRESS_CACHE_WAYS sets of CYPRESS_CACHE_WAYS lines
+static struct
+{
+    uint32_t Tag[CYPRESS_CACHE_LINES];      // Flash address of each line
+    uint32_t LastUse[CYPRESS_CACHE_LINES];  // Access stamp for LRU, 0 = invalid
+    uint8_t Data[CYPRESS_CACHE_LINES][CYPRESS_CACHE_LINE_SIZE];
+    uint32_t Clock;
+    Cypress_QSPI_CacheStats Stats;
+} cache;
+#endif
+
+#if (CYPRESS_PREFETCH_SIZE > 0)
+// Sequential read-ahead, filled by DMA in the background
+static struct
+{
+    uint32_t Address;       // Flash address of Buffer[0]
+    uint32_t Length;        // Bytes prefetched, or being prefetched
+    uint32_t NextAddress;   // Address that would continue the last request
+    uint8_t Sequential;     // The last request continued the one before it
+    uint8_t Used;           // Some of the prefetched block was read
+    volatile uint8_t State; // 0 = empty, 1 = in flight, 2 = ready
+    pQSPI_CallbackTypeDef SavedRxCplt;
+    pQSPI_CallbackTypeDef SavedError;
+    Cypress_QSPI_PrefetchStats Stats;
+    ALIGN_32BYTES(uint8_t Buffer[CYPRESS_PREFETCH_SIZE]);
+} prefetch = { .NextAddress = 0xFFFFFFFF, .Stats = { .Block = CYPRESS_PREFETCH_MIN_BLOCK } };
+#endif
+
+#if (CYPRESS_WRITE_COMBINE == 1)
+// Write-combining page buffer; pending bytes are ANDed like a program would, unwritten bytes are 0xFF
+static struct
+{
+    uint32_t Page;          // Address of the buffered page
+    uint32_t Low;           // Offset of the first written byte
+    uint32_t High;          // Offset after the last written byte
+    uint32_t Written;       // Distinct bytes written
+    uint32_t LastWrite;     // HAL tick of the last write
+    uint8_t Pending;
+    uint8_t Mask[CYPRESS_PAGE_SIZE / 8];
+    uint8_t Data[CYPRESS_PAGE_SIZE];
+} writeCombine;
+#endif
+
+/* Private macros */
+#define POOL_TEST(map, index)                 ((map)[(index) >> 3] & (1U << ((index) & 7)))
+#define POOL_SET(map, index)                  ((map)[(index) >> 3] |= (uint8_t)(1U << ((index) & 7)))
+#define POOL_CLEAR(map, index)                ((map)[(index) >> 3] &= (uint8_t)~(1U << ((index) & 7)))
+
+#if (CYPRESS_CACHE_LINES > 0)
+#define CACHE_INVALIDATE(address, count)    Cypress_QSPI_CacheInvalidate((address), (count))
+#define CACHE_INVALIDATE_ALL()              Cypress_QSPI_CacheInvalidateAll()
+#else
+#define CACHE_INVALIDATE(address, count)
+#define CACHE_INVALIDATE_ALL()
+#endif
+
+#if (CYPRESS_WRITE_COMBINE == 1)
+#define WRITE_COMBINE_OVERLAY(address, dest, count)     Cypress_QSPI_WriteCombineOverlay((address), (dest), (count))
+#define WRITE_COMBINE_FLUSH(hqspi)                      Cypress_QSPI_Flush(hqspi)
+#define WRITE_COMBINE_DISCARD(address, count)           Cypress_QSPI_WriteCombineDiscard((address), (count))
+#else
+#define WRITE_COMBINE_OVERLAY(address, dest, count)     ((void)(address), (void)(dest), (void)(count))
+#define WRITE_COMBINE_FLUSH(hqspi)                      ((void)(hqspi), HAL_OK)
+#define WRITE_COMBINE_DISCARD(address, count)
+#endif
+
+#if (CYPRESS_PREFETCH_SIZE > 0)
+#define PREFETCH_INVALIDATE(hqspi)          Cypress_QSPI_PrefetchInvalidate(hqspi)
+#else
+#define PREFETCH_INVALIDATE(hqspi)
+#endif
+
+#if (CYPRESS_WRITE_COMBINE == 1)
+static void Cypress_QSPI_WriteCombineOverlay(uint32_t address, uint8_t *dest, uint32_t count);
+static void Cypress_QSPI_WriteCombineDiscard(uint32_t address, uint32_t count);
+#endif
+
+/* Private constants */
+// Results of Cypress_QSPI_Compare
+#define COMPARE_SAME            0
+#define COMPARE_CLEAR_ONLY      1
+#define COMPARE_NEEDS_ERASE     2
+
+// Dummy cycles for each latency code, ordered by increasing maximum SCK frequency
+static const struct
+{
+    uint32_t MaxFrequency;
+    uint8_t  LatencyCode;
+    uint8_t  DummyFastRead;
+    uint8_t  DummyDual;
+    uint8_t  DummyDualIO;
+    uint8_t  DummyQuad;
+    uint8_t  DummyQuadIO;
+    uint8_t  DummyFastReadDDR;
+    uint8_t  DummyQuadIODDR;
+} latencyTable[] =
+{
+    {  50000000, CR1_LC3, 0, 0, 4, 0, 1, 1, 3 },
+    {  80000000, CR1_LC0, 8, 8, 8, 4, 4, 2, 6 },
+    {  90000000, CR1_LC1, 8, 8, 8, 5, 4, 4, 7 },
+    { CYPRESS_MAX_FREQUENCY, CR1_LC2, 8, 8, 8, 6, 5, 5, 8 },
+};
+
+// Fast read support bits in DWORD 1 of the SFDP basic flash parameter table
+static const struct
+{
+    uint32_t Bit;
+    uint32_t Capability;
+} sfdpReadModes[] =
+{
+    { 1UL << 16, CYPRESS_CAP_DUAL },
+    { 1UL << 19, CYPRESS_CAP_DDR },
+    { 1UL << 20, CYPRESS_CAP_DUAL_IO },
+    { 1UL << 21, CYPRESS_CAP_QUAD_IO },
+    { 1UL << 22, CYPRESS_CAP_QUAD },
+};
+
+// Indexes into commandTable
+#define CMD_WRITE_ENABLE        0
+#define CMD_WRITE_DISABLE       1
+#define CMD_READ_SR1            2
+#define CMD_READ_SR2            3
+#define CMD_READ_CR1            4
+#define CMD_CLEAR_SR            5
+#define CMD_WRITE_REGISTERS     6
+#define CMD_READ_DLP            7
+#define CMD_WRITE_VDLR          8
+#define CMD_PROGRAM_NVDLR       9
+#define CMD_SECTOR_ERASE        10
+#define CMD_PARAM_ERASE         11
+#define CMD_BULK_ERASE          12
+#define CMD_PROGRAM_SUSPEND     13
+#define CMD_PROGRAM_RESUME      14
+#define CMD_ERASE_SUSPEND       15
+#define CMD_ERASE_RESUME        16
+#define CMD_READ                17
+#define CMD_READ_DUAL           18
+#define CMD_READ_DUAL_IO        19
+#define CMD_READ_QUAD           20
+#define CMD_READ_QUAD_IO        21
+#define CMD_READ_DDR            22
+#define CMD_READ_QUAD_IO_DDR    23
+#define CMD_PAGE_PROGRAM        24
+#define CMD_QUAD_PROGRAM        25
+#define CMD_SOFTWARE_RESET      26
+#define CMD_MODE_BIT_RESET      27
+#define CMD_READ_ID             28
+#define CMD_READ_SFDP           29
+
+// Line modes of each command phase. The HAL mode values are the QUADSPI_CCR bit fields, so they can be packed
+// into one word and masked back out. Every command uses 32-bit addresses and an 8-bit alternate byte.
+#define MODES_INST              (QSPI_INSTRUCTION_1_LINE | QSPI_ADDRESS_32_BITS | QSPI_ALTERNATE_BYTES_8_BITS)
+#define MODES_INST_DATA         (MODES_INST | QSPI_DATA_1_LINE)
+#define MODES_INST_ADDR         (MODES_INST | QSPI_ADDRESS_1_LINE)
+#define MODES_1_1_1             (MODES_INST | QSPI_ADDRESS_1_LINE | QSPI_DATA_1_LINE)
+#define MODES_1_1_2             (MODES_INST | QSPI_ADDRESS_1_LINE | QSPI_DATA_2_LINES)
+#define MODES_1_2_2             (MODES_INST | QSPI_ADDRESS_2_LINES | QSPI_ALTERNATE_BYTES_2_LINES | QSPI_DATA_2_LINES)
+#define MODES_1_1_4             (MODES_INST | QSPI_ADDRESS_1_LINE | QSPI_DATA_4_LINES)
+#define MODES_1_4_4             (MODES_INST | QSPI_ADDRESS_4_LINES | QSPI_ALTERNATE_BYTES_4_LINES | QSPI_DATA_4_LINES)
+// SFDP is always read with 24-bit addresses
+#define MODES_SFDP              (QSPI_INSTRUCTION_1_LINE | QSPI_ADDRESS_24_BITS | QSPI_ALTERNATE_BYTES_8_BITS | QSPI_ADDRESS_1_LINE | QSPI_DATA_1_LINE)
+
+// Dummy cycles come from this field of activeTiming, or are a fixed count that does not follow the latency code
+#define DUMMY_FIXED_FLAG        0x80
+#define DUMMY(field)            ((uint8_t)offsetof(Cypress_QSPI_TimingProfile, field))
+#define DUMMY_FIXED(cycles)     ((uint8_t)(DUMMY_FIXED_FLAG | (cycles)))
+#define DUMMY_NONE              DUMMY_FIXED(0)
+
+// Everything about a command except its address and data length, see Cypress_QSPI_BuildCommand
+static const struct
+{
+    uint32_t Modes;             // QSPI_INSTRUCTION_x | QSPI_ADDRESS_x | QSPI_ALTERNATE_BYTES_x | QSPI_DATA_x | QSPI_DDR_x
+    uint8_t  Instruction;
+    uint8_t  Dummy;             // DUMMY(field), DUMMY_FIXED(cycles) or DUMMY_NONE
+    uint8_t  ModeClocks;        // Mode clocks sent as the alternate byte but counted in the latency
+} commandTable[] =
+{
+    [CMD_WRITE_ENABLE]      = { MODES_INST,      WRITE_ENABLE_CMD,                     DUMMY_NONE,                0 },
+    [CMD_WRITE_DISABLE]     = { MODES_INST,      WRITE_DISABLE_CMD,                    DUMMY_NONE,                0 },
+    [CMD_READ_SR1]          = { MODES_INST_DATA, READ_STATUS_REG1_CMD,                 DUMMY_NONE,                0 },
+    [CMD_READ_SR2]          = { MODES_INST_DATA, READ_STATUS_REG2_CMD,                 DUMMY_NONE,                0 },
+    [CMD_READ_CR1]          = { MODES_INST_DATA, READ_CONFIGURATION_REG1_CMD,          DUMMY_NONE,                0 },
+    [CMD_CLEAR_SR]          = { MODES_INST,      CLEAR_STATUS_REG1_CMD,                DUMMY_NONE,                0 },
+    [CMD_WRITE_REGISTERS]   = { MODES_INST_DATA, WRITE_STATUS_CMD_REG_CMD,             DUMMY_NONE,                0 },
+    [CMD_READ_DLP]          = { MODES_INST_DATA, READ_DATA_LEARNING_PATTERN_CMD,       DUMMY_NONE,                0 },
+    [CMD_WRITE_VDLR]        = { MODES_INST_DATA, WRITE_VOL_DATA_LEARNING_REG_CMD,      DUMMY_NONE,                0 },
+    [CMD_PROGRAM_NVDLR]     = { MODES_INST_DATA, PGM_NV_DATA_LEARNING_REG_CMD,         DUMMY_NONE,                0 },
+    [CMD_SECTOR_ERASE]      = { MODES_INST_ADDR, SECTOR_ERASE_4_BYTE_ADDR_CMD,         DUMMY_NONE,                0 },
+    [CMD_PARAM_ERASE]       = { MODES_INST_ADDR, PARAM_4K_ERASE_4_BYTE_ADDR_CMD,       DUMMY_NONE,                0 },
+    [CMD_BULK_ERASE]        = { MODES_INST,      BULK_ERASE_CMD,                       DUMMY_NONE,                0 },
+    [CMD_PROGRAM_SUSPEND]   = { MODES_INST,      PROGRAM_SUSPEND_CMD,                  DUMMY_NONE,                0 },
+    [CMD_PROGRAM_RESUME]    = { MODES_INST,      PROGRAM_RESUME_CMD,                   DUMMY_NONE,                0 },
+    [CMD_ERASE_SUSPEND]     = { MODES_INST,      PROG_ERASE_SUSPEND_CMD,               DUMMY_NONE,                0 },
+    [CMD_ERASE_RESUME]      = { MODES_INST,      PROG_ERASE_RESUME_CMD,                DUMMY_NONE,                0 },
+    [CMD_READ]              = { MODES_1_1_1,     READ_4_BYTE_ADDR_CMD,                 DUMMY_NONE,                0 },
+    [CMD_READ_DUAL]         = { MODES_1_1_2,     DUAL_OUT_FAST_READ_4_BYTE_ADDR_CMD,   DUMMY(DummyDual),          0 },
+    [CMD_READ_DUAL_IO]      = { MODES_1_2_2,     DUAL_INOUT_FAST_READ_4_BYTE_ADDR_CMD, DUMMY(DummyDualIO),        4 },
+    [CMD_READ_QUAD]         = { MODES_1_1_4,     QUAD_OUT_FAST_READ_4_BYTE_ADDR_CMD,   DUMMY(DummyQuad),          0 },
+    [CMD_READ_QUAD_IO]      = { MODES_1_4_4,     QUAD_INOUT_FAST_READ_4_BYTE_ADDR_CMD, DUMMY(DummyQuadIO),        0 },
+    [CMD_READ_DDR]          = { MODES_1_1_1 | QSPI_ALTERNATE_BYTES_1_LINE | QSPI_DDR_MODE_ENABLE,
+                                                 FAST_READ__DDR_4_BYTE_ADDR_CMD,       DUMMY(DummyFastReadDDR),   0 },
+    [CMD_READ_QUAD_IO_DDR]  = { MODES_1_4_4 | QSPI_DDR_MODE_ENABLE,
+                                                 QUAD_INOUT_READ_DDR_4_BYTE_ADDR_CMD,  DUMMY(DummyQuadIODDR),     0 },
+    [CMD_PAGE_PROGRAM]      = { MODES_1_1_1,     PAGE_PROG_4_BYTE_ADDR_CMD,            DUMMY_NONE,                0 },
+    [CMD_QUAD_PROGRAM]      = { MODES_1_1_4,     QUAD_IN_FAST_PROG_4_BYTE_ADDR_CMD,    DUMMY_NONE,                0 },
+    [CMD_SOFTWARE_RESET]    = { MODES_INST,      SOFTWARE_RESET_CMD,                   DUMMY_NONE,                0 },
+    [CMD_MODE_BIT_RESET]    = { MODES_INST,      MODE_BIT_RESET_CMD,                   DUMMY_NONE,                0 },
+    [CMD_READ_ID]           = { MODES_INST_DATA, READ_ID_CMD2,                         DUMMY_NONE,                0 },
+    [CMD_READ_SFDP]         = { MODES_SFDP,      READ_SERIAL_FLASH_DISCO_PARAM_CMD,    DUMMY_FIXED(8),            0 },
+};
 
 /**
-* @brief   Enable write operations and wait until effective (blocking)
+* @brief   Fills a HAL command from its entry in the command table
+* @param   command: CMD_x index into the command table
+* @param   address: address to send, ignored if the command has no address phase
+* @param   count: bytes of data, 0 if the command has no data phase
+* @param   sCommand: command to fill
+* @note    Dummy cycles and the DDR hold come from the active timing profile, except for fixed dummy cycles
+*/
+
+static void Cypress_QSPI_BuildCommand(uint8_t command, uint32_t address, uint32_t count, QSPI_CommandTypeDef *sCommand)
+{
+    uint32_t modes = commandTable[command].Modes;
+    uint8_t dummy = commandTable[command].Dummy;
+
+    sCommand->Instruction        = commandTable[command].Instruction;
+    sCommand->Address            = address;
+    sCommand->AlternateBytes     = 0;
+    sCommand->AddressSize        = modes & QUADSPI_CCR_ADSIZE;
+    sCommand->AlternateBytesSize = modes & QUADSPI_CCR_ABSIZE;
+    sCommand->DummyCycles        = (dummy & DUMMY_FIXED_FLAG) ? (dummy & ~DUMMY_FIXED_FLAG) : (((const uint8_t *)&activeTiming)[dummy] - commandTable[command].ModeClocks);
+    sCommand->InstructionMode    = modes & QUADSPI_CCR_IMODE;
+    sCommand->AddressMode        = modes & QUADSPI_CCR_ADMODE;
+    sCommand->AlternateByteMode  = modes & QUADSPI_CCR_ABMODE;
+    sCommand->DataMode           = modes & QUADSPI_CCR_DMODE;
+    sCommand->NbData             = count;
+    sCommand->DdrMode            = modes & QUADSPI_CCR_DDRM;
+    sCommand->DdrHoldHalfCycle   = (modes & QUADSPI_CCR_DDRM) ? activeTiming.DdrHoldHalfCycle : QSPI_DDR_HHC_ANALOG_DELAY;
+    sCommand->SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
+}
+
+/**
+* @brief   Sends a command from the command table (blocking)
 * @param   hqspi: QSPI handle
+* @param   command: CMD_x index into the command table
+* @param   address: address to send, ignored if the command has no address phase
+* @param   count: bytes of data to transfer afterwards, 0 if the command has no data phase
 * @return  HAL status
 */
 
-HAL_StatusTypeDef Cypress_QSPI_WriteEnable(QSPI_HandleTypeDef *hqspi)
+static HAL_StatusTypeDef Cypress_QSPI_IssueCommand(QSPI_HandleTypeDef *hqspi, uint8_t command, uint32_t address, uint32_t count)
 {
-    QSPI_CommandTypeDef     sCommand;
+    QSPI_CommandTypeDef sCommand;
 
-    // Send WREN
-    sCommand.Instruction        = WRITE_ENABLE_CMD;
-    sCommand.Address            = 0;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = 0;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_NONE;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode           = QSPI_DATA_NONE;
-    sCommand.NbData             = 0;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
+    Cypress_QSPI_BuildCommand(command, address, count, &sCommand);
+
+    return HAL_QSPI_Command(hqspi, &sCommand, HAL_QSPI_TIMEOUT_DEFAULT_VALUE);
+}
 
+/**
+* @brief   Masks interrupts for a short critical section
+* @return  PRIMASK before masking, to pass to \ref Cypress_QSPI_ExitCritical
+* @note    Safe to nest and to call with interrupts already masked
+*/
 
-    if (HAL_QSPI_Command(hqspi, &sCommand, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+static uint32_t Cypress_QSPI_EnterCritical(void)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+
+    return primask;
+}
+
+/**
+* @brief   Ends a critical section started by \ref Cypress_QSPI_EnterCritical
+* @param   primask: value returned by Cypress_QSPI_EnterCritical
+* @note    Interrupts stay masked if they were masked on entry
+*/
+
+static void Cypress_QSPI_ExitCritical(uint32_t primask)
+{
+    __set_PRIMASK(primask);
+}
+
+#if (CYPRESS_REGISTER_FAST_PATH == 1)
+/**
+* @brief   Sends a short register command by writing the QUADSPI registers directly (blocking, ISR safe)
+* @param   hqspi: QSPI handle
+* @param   command: CMD_x index into the command table, with no address phase and at most one data byte to read
+* @param   result: Location to store the byte read, NULL for commands without a data phase
+* @return  HAL status, HAL_BUSY if the peripheral is in use, HAL_TIMEOUT if the transfer did not complete
+* @note    Skips the HAL locking, state changes and tick based timeouts; the HAL state stays READY throughout.
+*          Interrupts are masked for the transfer, which is only 16 SCK cycles long.
+* @post    If HAL_TIMEOUT, the transfer has been aborted and the completion and error flags cleared
+*/
+
+static HAL_StatusTypeDef Cypress_QSPI_FastCommand(QSPI_HandleTypeDef *hqspi, uint8_t command, uint8_t *result)
+{
+    QUADSPI_TypeDef *regs = hqspi->Instance;
+    uint32_t modes = commandTable[command].Modes;
+    uint32_t spins = CYPRESS_FAST_PATH_SPINS;
+    uint32_t primask;
+    HAL_StatusTypeDef status = HAL_OK;
+
+    primask = Cypress_QSPI_EnterCritical();
+
+    if ((hqspi->State != HAL_QSPI_STATE_READY) || (hqspi->Lock != HAL_UNLOCKED) || READ_BIT(regs->SR, QUADSPI_SR_BUSY))
+    {
+        Cypress_QSPI_ExitCritical(primask);
+        return HAL_BUSY;
+    }
+
+    WRITE_REG(regs->FCR, QUADSPI_FCR_CTCF);
+
+    if (modes & QUADSPI_CCR_DMODE)
+    {
+        // DLR holds the byte count minus one
+        WRITE_REG(regs->DLR, 0);
+        modes |= QSPI_FUNCTIONAL_MODE_INDIRECT_READ;
+    }
+
+    // Without an address phase, writing CCR starts the transfer
+    WRITE_REG(regs->CCR, modes | commandTable[command].Instruction);
+
+    while (!READ_BIT(regs->SR, QUADSPI_SR_TCF))
+    {
+        if (--spins == 0)
+        {
+            SET_BIT(regs->CR, QUADSPI_CR_ABORT);
+            status = HAL_TIMEOUT;
+            break;
+        }
+    }
+
+    if (status == HAL_OK)
+    {
+        if (result != NULL)
+        {
+            *result = *(__IO uint8_t *)&regs->DR;
+        }
+
+        WRITE_REG(regs->FCR, QUADSPI_FCR_CTCF);
+    }
+    else
+    {
+        // Leave the peripheral idle and without stale flags for the next HAL transfer
+        spins = CYPRESS_FAST_PATH_SPINS;
+
+        while (READ_BIT(regs->CR, QUADSPI_CR_ABORT) && (--spins != 0))
+        {
+            // ABORT clears itself once the peripheral has stopped
+        }
+
+        WRITE_REG(regs->FCR, QUADSPI_FCR_CTCF | QUADSPI_FCR_CTEF);
+    }
+
+    Cypress_QSPI_ExitCritical(primask);
+
+    return status;
+}
+#endif
+
+/**
+* @brief   Enable write operations and wait until effective (blocking)
+* @param   hqspi: QSPI handle
+* @return  HAL status
+* @note    Safe to call from interrupts with the \ref QSPI_FAST_PATH enabled
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_WriteEnable(QSPI_HandleTypeDef *hqspi)
+{
+#if (CYPRESS_REGISTER_FAST_PATH == 1)
+    return Cypress_QSPI_FastCommand(hqspi, CMD_WRITE_ENABLE, NULL);
+#else
+    // Send WREN
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_WRITE_ENABLE, 0, 0) != HAL_OK)
     {
         return HAL_ERROR;
     }
 
     return HAL_OK;
+#endif
 }
 
 /**
@@ -64,24 +521,7 @@ HAL_StatusTypeDef Cypress_QSPI_WriteEnable(QSPI_HandleTypeDef *hqspi)
 
 HAL_StatusTypeDef Cypress_QSPI_WriteDisable(QSPI_HandleTypeDef *hqspi)
 {
-    QSPI_CommandTypeDef     sCommand;
-
-    sCommand.Instruction        = WRITE_DISABLE_CMD;
-    sCommand.Address            = 0;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = 0;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_NONE;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode           = QSPI_DATA_NONE;
-    sCommand.NbData             = 0;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
-
-    if (HAL_QSPI_Command(hqspi, &sCommand, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_WRITE_DISABLE, 0, 0) != HAL_OK)
     {
         return HAL_ERROR;
     }
@@ -129,20 +569,7 @@ HAL_StatusTypeDef Cypress_QSPI_WaitMemReady(QSPI_HandleTypeDef *hqspi, uint32_t
     QSPI_AutoPollingTypeDef sConfig;
 
     // Read SR1
-    sCommand.Instruction        = READ_STATUS_REG1_CMD;
-    sCommand.Address            = 0;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = 0;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_NONE;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode           = QSPI_DATA_1_LINE;
-    sCommand.NbData             = 0;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
+    Cypress_QSPI_BuildCommand(CMD_READ_SR1, 0, 0, &sCommand);
 
     if (HAL_QSPI_Command(hqspi, &sCommand, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
     {
@@ -180,20 +607,7 @@ HAL_StatusTypeDef Cypress_QSPI_WaitMemReady_IT(QSPI_HandleTypeDef *hqspi)
     QSPI_AutoPollingTypeDef sConfig;
 
     // Read SR1
-    sCommand.Instruction        = READ_STATUS_REG1_CMD;
-    sCommand.Address            = 0;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = 0;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_NONE;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode           = QSPI_DATA_1_LINE;
-    sCommand.NbData             = 0;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
+    Cypress_QSPI_BuildCommand(CMD_READ_SR1, 0, 0, &sCommand);
 
     if (HAL_QSPI_Command(hqspi, &sCommand, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
     {
@@ -231,20 +645,7 @@ HAL_StatusTypeDef Cypress_QSPI_WaitWriteReady(QSPI_HandleTypeDef *hqspi, uint32_
     QSPI_AutoPollingTypeDef sConfig;
 
     // Read SR1
-    sCommand.Instruction        = READ_STATUS_REG1_CMD;
-    sCommand.Address            = 0;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = 0;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_NONE;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode           = QSPI_DATA_1_LINE;
-    sCommand.NbData             = 0;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
+    Cypress_QSPI_BuildCommand(CMD_READ_SR1, 0, 0, &sCommand);
 
     if (HAL_QSPI_Command(hqspi, &sCommand, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
     {
@@ -281,20 +682,7 @@ HAL_StatusTypeDef Cypress_QSPI_WaitWriteReady_IT(QSPI_HandleTypeDef *hqspi)
     QSPI_AutoPollingTypeDef sConfig;
 
     // Read SR1
-    sCommand.Instruction        = READ_STATUS_REG1_CMD;
-    sCommand.Address            = 0;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = 0;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_NONE;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode           = QSPI_DATA_1_LINE;
-    sCommand.NbData             = 0;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
+    Cypress_QSPI_BuildCommand(CMD_READ_SR1, 0, 0, &sCommand);
 
     if (HAL_QSPI_Command(hqspi, &sCommand, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
     {
@@ -324,28 +712,15 @@ HAL_StatusTypeDef Cypress_QSPI_WaitWriteReady_IT(QSPI_HandleTypeDef *hqspi)
 * @param   hqspi: QSPI handle
 * @param   result: Location to store SR1
 * @return  HAL status
+* @note    Safe to call from interrupts with the \ref QSPI_FAST_PATH enabled
 */
 
 HAL_StatusTypeDef Cypress_QSPI_ReadSR1(QSPI_HandleTypeDef *hqspi, uint8_t *result)
 {
-    QSPI_CommandTypeDef     sCommand;
-
-    sCommand.Instruction        = READ_STATUS_REG1_CMD;
-    sCommand.Address            = 0;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = 0;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_NONE;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode           = QSPI_DATA_1_LINE;
-    sCommand.NbData             = 1;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
-
-    if (HAL_QSPI_Command(hqspi, &sCommand, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+#if (CYPRESS_REGISTER_FAST_PATH == 1)
+    return Cypress_QSPI_FastCommand(hqspi, CMD_READ_SR1, result);
+#else
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_READ_SR1, 0, 1) != HAL_OK)
     {
         return HAL_ERROR;
     }
@@ -356,6 +731,7 @@ HAL_StatusTypeDef Cypress_QSPI_ReadSR1(QSPI_HandleTypeDef *hqspi, uint8_t *resul
     }
 
     return HAL_OK;
+#endif
 }
 
 /**
@@ -363,28 +739,15 @@ HAL_StatusTypeDef Cypress_QSPI_ReadSR1(QSPI_HandleTypeDef *hqspi, uint8_t *resul
 * @param   hqspi: QSPI handle
 * @param   result: Location to store SR2
 * @return  HAL status
+* @note    Safe to call from interrupts with the \ref QSPI_FAST_PATH enabled
 */
 
 HAL_StatusTypeDef Cypress_QSPI_ReadSR2(QSPI_HandleTypeDef *hqspi, uint8_t *result)
 {
-    QSPI_CommandTypeDef     sCommand;
-
-    sCommand.Instruction        = READ_STATUS_REG2_CMD;
-    sCommand.Address            = 0;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = 0;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_NONE;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode           = QSPI_DATA_1_LINE;
-    sCommand.NbData             = 1;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
-
-    if (HAL_QSPI_Command(hqspi, &sCommand, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+#if (CYPRESS_REGISTER_FAST_PATH == 1)
+    return Cypress_QSPI_FastCommand(hqspi, CMD_READ_SR2, result);
+#else
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_READ_SR2, 0, 1) != HAL_OK)
     {
         return HAL_ERROR;
     }
@@ -395,6 +758,7 @@ HAL_StatusTypeDef Cypress_QSPI_ReadSR2(QSPI_HandleTypeDef *hqspi, uint8_t *resul
     }
 
     return HAL_OK;
+#endif
 }
 
 /**
@@ -402,28 +766,15 @@ HAL_StatusTypeDef Cypress_QSPI_ReadSR2(QSPI_HandleTypeDef *hqspi, uint8_t *resul
 * @param   hqspi: QSPI handle
 * @param   result: Location to store the CR
 * @return  HAL status
+* @note    Safe to call from interrupts with the \ref QSPI_FAST_PATH enabled
 */
 
 HAL_StatusTypeDef Cypress_QSPI_ReadCR(QSPI_HandleTypeDef *hqspi, uint8_t *result)
 {
-    QSPI_CommandTypeDef     sCommand;
-
-    sCommand.Instruction        = READ_CONFIGURATION_REG1_CMD;
-    sCommand.Address            = 0;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = 0;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_NONE;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode           = QSPI_DATA_1_LINE;
-    sCommand.NbData             = 1;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
-
-    if (HAL_QSPI_Command(hqspi, &sCommand, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+#if (CYPRESS_REGISTER_FAST_PATH == 1)
+    return Cypress_QSPI_FastCommand(hqspi, CMD_READ_CR1, result);
+#else
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_READ_CR1, 0, 1) != HAL_OK)
     {
         return HAL_ERROR;
     }
@@ -434,6 +785,7 @@ HAL_StatusTypeDef Cypress_QSPI_ReadCR(QSPI_HandleTypeDef *hqspi, uint8_t *result
     }
 
     return HAL_OK;
+#endif
 }
 
 /**
@@ -444,24 +796,7 @@ HAL_StatusTypeDef Cypress_QSPI_ReadCR(QSPI_HandleTypeDef *hqspi, uint8_t *result
 
 HAL_StatusTypeDef Cypress_QSPI_ClearSR(QSPI_HandleTypeDef *hqspi)
 {
-    QSPI_CommandTypeDef     sCommand;
-
-    sCommand.Instruction        = CLEAR_STATUS_REG1_CMD;
-    sCommand.Address            = 0;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = 0;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_NONE;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode           = QSPI_DATA_NONE;
-    sCommand.NbData             = 0;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
-
-    if (HAL_QSPI_Command(hqspi, &sCommand, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_CLEAR_SR, 0, 0) != HAL_OK)
     {
         return HAL_ERROR;
     }
@@ -505,24 +840,7 @@ HAL_StatusTypeDef Cypress_QSPI_WriteSR1(QSPI_HandleTypeDef *hqspi, uint8_t sReg)
 {
     Cypress_QSPI_WriteEnable(hqspi);
 
-    QSPI_CommandTypeDef sCommand;
-
-    sCommand.Instruction        = WRITE_STATUS_CMD_REG_CMD;
-    sCommand.Address            = 0;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = 0;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_NONE;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode           = QSPI_DATA_1_LINE;
-    sCommand.NbData             = 1;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
-
-    if (HAL_QSPI_Command(hqspi, &sCommand, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_WRITE_REGISTERS, 0, 1) != HAL_OK)
     {
         return HAL_ERROR;
     }
@@ -560,24 +878,7 @@ HAL_StatusTypeDef Cypress_QSPI_WriteCR(QSPI_HandleTypeDef *hqspi, uint8_t cReg)
     Cypress_QSPI_WriteEnable(hqspi);
 
     // Send configuration
-    QSPI_CommandTypeDef sCommand;
-
-    sCommand.Instruction        = WRITE_STATUS_CMD_REG_CMD;
-    sCommand.Address            = 0;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = 0;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_NONE;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode           = QSPI_DATA_1_LINE;
-    sCommand.NbData             = 2;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
-
-    if (HAL_QSPI_Command(hqspi, &sCommand, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_WRITE_REGISTERS, 0, 2) != HAL_OK)
     {
         return HAL_ERROR;
     }
@@ -596,49 +897,45 @@ HAL_StatusTypeDef Cypress_QSPI_WriteCR(QSPI_HandleTypeDef *hqspi, uint8_t cReg)
 }
 
 /**
-* @brief   Sets all bits in a sector to 1 (blocking)
+* @brief   Reads the Data Learning Register to a variable
 * @param   hqspi: QSPI handle
-* @param   address: address within the sector to erase
+* @param   result: Location to store the DLR
 * @return  HAL status
-* @post    If error, call Cypress_QSPI_ErrorRecovery to clear errors
 */
 
-HAL_StatusTypeDef Cypress_QSPI_SectorErase(QSPI_HandleTypeDef *hqspi, uint32_t address)
+HAL_StatusTypeDef Cypress_QSPI_ReadDLR(QSPI_HandleTypeDef *hqspi, uint8_t *result)
 {
-    Cypress_QSPI_WriteEnable(hqspi);
-
-    QSPI_CommandTypeDef sCommand;
-
-    sCommand.Instruction        = SECTOR_ERASE_4_BYTE_ADDR_CMD;
-    sCommand.Address            = address;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = 0;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_1_LINE;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode           = QSPI_DATA_NONE;
-    sCommand.NbData             = 0;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_READ_DLP, 0, 1) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
 
-    if  (HAL_QSPI_Command(hqspi, &sCommand, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    if (HAL_QSPI_Receive(hqspi, result, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
     {
         return HAL_ERROR;
     }
 
-    // Wait for the erase to complete
-    if  (Cypress_QSPI_WaitMemReady(hqspi, SECTOR_ERASE_MAX_TIME) != HAL_OK)
+    return HAL_OK;
+}
+
+/**
+* @brief   Writes the volatile Data Learning Register
+* @param   hqspi: QSPI handle
+* @param   pattern: Data Learning Pattern, output during the dummy cycles of DDR reads when non-zero
+* @return  HAL status
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_WriteDLR(QSPI_HandleTypeDef *hqspi, uint8_t pattern)
+{
+    Cypress_QSPI_WriteEnable(hqspi);
+
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_WRITE_VDLR, 0, 1) != HAL_OK)
     {
         return HAL_ERROR;
     }
 
-    // Verify the erase worked properly
-    if  (Cypress_QSPI_CheckForErrors(hqspi) != HAL_OK)
+    if (HAL_QSPI_Transmit(hqspi, &pattern, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
     {
-        // If failed, SR1 should be cleared to recover
         return HAL_ERROR;
     }
 
@@ -646,86 +943,68 @@ HAL_StatusTypeDef Cypress_QSPI_SectorErase(QSPI_HandleTypeDef *hqspi, uint32_t a
 }
 
 /**
-* @brief   Sets all bits in a sector to 1 (non-blocking, requires interrupts)
+* @brief   Programs the non-volatile Data Learning Register (blocking)
 * @param   hqspi: QSPI handle
-* @param   address: address within the sector to erase
+* @param   pattern: Data Learning Pattern loaded into the volatile DLR at every power-up
 * @return  HAL status
-* @post    User should verify that no errors occurred after erase
-* @remark  Calls HAL_QSPI_StatusMatchCallback when complete via interrupt
+* @note    The non-volatile DLR is OTP: it can only be programmed once
 */
 
-HAL_StatusTypeDef Cypress_QSPI_SectorErase_IT(QSPI_HandleTypeDef *hqspi, uint32_t address)
+HAL_StatusTypeDef Cypress_QSPI_ProgramDLR(QSPI_HandleTypeDef *hqspi, uint8_t pattern)
 {
     Cypress_QSPI_WriteEnable(hqspi);
 
-    QSPI_CommandTypeDef sCommand;
-
-    sCommand.Instruction        = SECTOR_ERASE_4_BYTE_ADDR_CMD;
-    sCommand.Address            = address;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = 0;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_1_LINE;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode           = QSPI_DATA_NONE;
-    sCommand.NbData             = 0;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_PROGRAM_NVDLR, 0, 1) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
 
-    if  (HAL_QSPI_Command(hqspi, &sCommand, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    if (HAL_QSPI_Transmit(hqspi, &pattern, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
     {
         return HAL_ERROR;
     }
 
-    // This will call HAL_QSPI_StatusMatchCallback when complete
-    if  (Cypress_QSPI_WaitMemReady_IT(hqspi) != HAL_OK)
+    if (Cypress_QSPI_WaitMemReady(hqspi, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
     {
         return HAL_ERROR;
     }
 
-    // User should verify that no errors were raised after the callback occurs
+    // Verify no errors occurred during the program
+    if  (Cypress_QSPI_CheckForErrors(hqspi) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
     return HAL_OK;
 }
 
 /**
-* @brief   Sets *all* bits in the flash memory to 1 (blocking)
+* @brief   Sets all bits in a sector to 1 (blocking)
 * @param   hqspi: QSPI handle
+* @param   address: address within the sector to erase
 * @return  HAL status
 * @post    If error, call Cypress_QSPI_ErrorRecovery to clear errors
 */
 
-HAL_StatusTypeDef Cypress_QSPI_BulkErase(QSPI_HandleTypeDef *hqspi)
+HAL_StatusTypeDef Cypress_QSPI_SectorErase(QSPI_HandleTypeDef *hqspi, uint32_t address)
 {
-    Cypress_QSPI_WriteEnable(hqspi);
-
-    QSPI_CommandTypeDef sCommand;
+    CACHE_INVALIDATE(address & ~(CYPRESS_SECTOR_SIZE - 1), CYPRESS_SECTOR_SIZE);
+    WRITE_COMBINE_DISCARD(address & ~(CYPRESS_SECTOR_SIZE - 1), CYPRESS_SECTOR_SIZE);
+    PREFETCH_INVALIDATE(hqspi);
 
-    sCommand.Instruction        = BULK_ERASE_CMD;
-    sCommand.Address            = 0;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = 0;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_NONE;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode           = QSPI_DATA_NONE;
-    sCommand.NbData             = 0;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
+    Cypress_QSPI_WriteEnable(hqspi);
 
-    if  (HAL_QSPI_Command(hqspi, &sCommand, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_SECTOR_ERASE, address, 0) != HAL_OK)
     {
         return HAL_ERROR;
     }
 
-    if  (Cypress_QSPI_WaitMemReady(hqspi, BULK_ERASE_MAX_TIME))
+    // Wait for the erase to complete
+    if  (Cypress_QSPI_WaitMemReady(hqspi, SECTOR_ERASE_MAX_TIME) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
 
-    // If any block protection bits are set, this will fail!
+    // Verify the erase worked properly
     if  (Cypress_QSPI_CheckForErrors(hqspi) != HAL_OK)
     {
         // If failed, SR1 should be cleared to recover
@@ -736,35 +1015,23 @@ HAL_StatusTypeDef Cypress_QSPI_BulkErase(QSPI_HandleTypeDef *hqspi)
 }
 
 /**
-* @brief   Sets *all* bits in the flash memory to 1 (non-blocking, requires interrupts)
+* @brief   Sets all bits in a sector to 1 (non-blocking, requires interrupts)
 * @param   hqspi: QSPI handle
+* @param   address: address within the sector to erase
 * @return  HAL status
 * @post    User should verify that no errors occurred after erase
 * @remark  Calls HAL_QSPI_StatusMatchCallback when complete via interrupt
 */
 
-HAL_StatusTypeDef Cypress_QSPI_BulkErase_IT(QSPI_HandleTypeDef *hqspi)
+HAL_StatusTypeDef Cypress_QSPI_SectorErase_IT(QSPI_HandleTypeDef *hqspi, uint32_t address)
 {
-    Cypress_QSPI_WriteEnable(hqspi);
-
-    QSPI_CommandTypeDef sCommand;
+    CACHE_INVALIDATE(address & ~(CYPRESS_SECTOR_SIZE - 1), CYPRESS_SECTOR_SIZE);
+    WRITE_COMBINE_DISCARD(address & ~(CYPRESS_SECTOR_SIZE - 1), CYPRESS_SECTOR_SIZE);
+    PREFETCH_INVALIDATE(hqspi);
 
-    sCommand.Instruction        = BULK_ERASE_CMD;
-    sCommand.Address            = 0;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = 0;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_NONE;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode           = QSPI_DATA_NONE;
-    sCommand.NbData             = 0;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
+    Cypress_QSPI_WriteEnable(hqspi);
 
-    if  (HAL_QSPI_Command(hqspi, &sCommand, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_SECTOR_ERASE, address, 0) != HAL_OK)
     {
         return HAL_ERROR;
     }
@@ -776,218 +1043,208 @@ HAL_StatusTypeDef Cypress_QSPI_BulkErase_IT(QSPI_HandleTypeDef *hqspi)
     }
 
     // User should verify that no errors were raised after the callback occurs
-    // e.g. if any block protection is set, this will fail
     return HAL_OK;
 }
 
 /**
-* @brief   Reads data into memory in SPI mode (blocking)
+* @brief   Gets the start of the parameter sectors from CR1_TBPARM
 * @param   hqspi: QSPI handle
-* @param   address: starting address to read
-* @param   dest: pointer to memory destination
-* @param   count: bytes to read
+* @param   paramStart: Location to store the address of the first parameter sector
 * @return  HAL status
 */
 
-HAL_StatusTypeDef Cypress_QSPI_Read(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+static HAL_StatusTypeDef Cypress_QSPI_GetParamStart(QSPI_HandleTypeDef *hqspi, uint32_t *paramStart)
 {
-    QSPI_CommandTypeDef sCommand;
+    uint8_t configRegister;
 
-    sCommand.Instruction        = READ_4_BYTE_ADDR_CMD;
-    sCommand.Address            = address;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = 0;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_1_LINE;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode           = QSPI_DATA_1_LINE;
-    sCommand.NbData             = count;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
+    *paramStart = 0;
 
-    if  (HAL_QSPI_Command(hqspi, &sCommand, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    if (CYPRESS_PARAM_SECTOR_COUNT == 0)
     {
-        return HAL_ERROR;
+        return HAL_OK;
     }
 
-    if (HAL_QSPI_Receive(hqspi, dest, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    if (Cypress_QSPI_ReadCR(hqspi, &configRegister) != HAL_OK)
     {
         return HAL_ERROR;
     }
 
+    if (configRegister & CR1_TBPARM)
+    {
+        *paramStart = CYPRESS_FLASH_SIZE - (CYPRESS_PARAM_SECTOR_COUNT * CYPRESS_PARAM_SECTOR_SIZE);
+    }
+
     return HAL_OK;
 }
 
 /**
-* @brief   Reads data into memory in SPI mode (non-blocking, requires callbacks)
-* @param   hqspi: QSPI handle
-* @param   address: starting address to read
-* @param   dest: pointer to memory destination
-* @param   count: bytes to read
-* @return  HAL status
-* @remark  Calls HAL_QSPI_RxCpltCallback on completion via interrupt
+* @brief   Gets the size of the erase block containing an address
+* @param   address: address to look up
+* @param   paramStart: address of the first parameter sector, from \ref Cypress_QSPI_GetParamStart
+* @return  CYPRESS_PARAM_SECTOR_SIZE or CYPRESS_SECTOR_SIZE
 */
 
-HAL_StatusTypeDef Cypress_QSPI_Read_IT(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+static uint32_t Cypress_QSPI_GetBlockSize(uint32_t address, uint32_t paramStart)
 {
-    QSPI_CommandTypeDef sCommand;
-
-    sCommand.Instruction        = READ_4_BYTE_ADDR_CMD;
-    sCommand.Address            = address;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = 0;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_1_LINE;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode           = QSPI_DATA_1_LINE;
-    sCommand.NbData             = count;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
-
-    if  (HAL_QSPI_Command(hqspi, &sCommand, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    if ((CYPRESS_PARAM_SECTOR_COUNT > 0) && (address >= paramStart) &&
+        (address < (paramStart + (CYPRESS_PARAM_SECTOR_COUNT * CYPRESS_PARAM_SECTOR_SIZE))))
     {
-        return HAL_ERROR;
-    }
-
-    // Will call HAL_QSPI_RxCpltCallback on completion
-    if (HAL_QSPI_Receive_IT(hqspi, dest) != HAL_OK)
-    {
-        return HAL_ERROR;
+        return CYPRESS_PARAM_SECTOR_SIZE;
     }
 
-    return HAL_OK;
+    return CYPRESS_SECTOR_SIZE;
 }
 
 /**
-* @brief   Reads data directly into memory in SPI mode (non-blocking, requires callbacks)
+* @brief   Finds the erase block containing an address, taking the parameter sectors into account
 * @param   hqspi: QSPI handle
-* @param   address: starting address to read
-* @param   dest: pointer to memory destination
-* @param   count: bytes to read
+* @param   address: address to look up, replaced by the start of its erase block
+* @param   size: Location to store the size of the erase block
 * @return  HAL status
-* @remark  Calls HAL_QSPI_RxCpltCallback on completion via interrupt
+* @note    Parameter sectors are at the top of the array if CR1_TBPARM is set, at the bottom otherwise.
+*          Without parameter sectors (CYPRESS_PARAM_SECTOR_COUNT is 0) every block is a CYPRESS_SECTOR_SIZE sector.
 */
 
-HAL_StatusTypeDef Cypress_QSPI_Read_DMA(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+HAL_StatusTypeDef Cypress_QSPI_GetEraseBlock(QSPI_HandleTypeDef *hqspi, uint32_t *address, uint32_t *size)
 {
-    QSPI_CommandTypeDef sCommand;
-
-    sCommand.Instruction        = READ_4_BYTE_ADDR_CMD;
-    sCommand.Address            = address;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = 0;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_1_LINE;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode           = QSPI_DATA_1_LINE;
-    sCommand.NbData             = count;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
+    uint32_t paramStart;
 
-    if  (HAL_QSPI_Command(hqspi, &sCommand, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    if (Cypress_QSPI_GetParamStart(hqspi, &paramStart) != HAL_OK)
     {
         return HAL_ERROR;
     }
 
-    // Will call HAL_QSPI_RxCpltCallback on completion
-    if (HAL_QSPI_Receive_DMA(hqspi, dest) != HAL_OK)
-    {
-        return HAL_ERROR;
-    }
+    *size = Cypress_QSPI_GetBlockSize(*address, paramStart);
+    *address &= ~(*size - 1);
 
     return HAL_OK;
 }
 
 /**
-* @brief   Reads data into memory using QSPI (blocking)
-* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
-* @pre     The latency codes must be set appropriately, \ref QSPI_DUMMY
-* @param   hqspi: QSPI handle
-* @param   address: starting address to read
-* @param   dest: pointer to memory destination
-* @param   count: bytes to read
-* @return  HAL status
-* @note    this took me like 3 days to make work: it sends a mode byte as an alternate byte that is super-duper required
+* @brief   Works out the erases needed for a range
+* @param   start: first address to erase, on an erase block boundary
+* @param   length: bytes to erase, ending on an erase block boundary
+* @param   paramStart: address of the first parameter sector, from \ref Cypress_QSPI_GetParamStart
+* @param   plan: Location to store the plan
+* @return  HAL status, HAL_ERROR if the range is empty or does not line up with erase blocks
 */
 
-HAL_StatusTypeDef Cypress_QSPI_ReadQuad(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+static HAL_StatusTypeDef Cypress_QSPI_PlanErase(uint32_t start, uint32_t length, uint32_t paramStart, Cypress_QSPI_ErasePlan *plan)
 {
-    QSPI_CommandTypeDef sCommand;
+    uint32_t address = start;
+    uint32_t size;
 
-    sCommand.Instruction        = QUAD_INOUT_FAST_READ_4_BYTE_ADDR_CMD;
-    sCommand.Address            = address;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = CYPRESS_DUMMY_CLOCK_CYCLES_READ_QUADIO;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_4_LINES;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_4_LINES;
-    sCommand.DataMode           = QSPI_DATA_4_LINES;
-    sCommand.NbData             = count;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
+    plan->ParameterErases = 0;
+    plan->SectorErases = 0;
+    plan->BulkErase = 0;
+    plan->EstimatedTime = 0;
 
-    if  (HAL_QSPI_Command(hqspi, &sCommand, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    if ((length == 0) || (length > CYPRESS_FLASH_SIZE) || (start > (CYPRESS_FLASH_SIZE - length)))
     {
         return HAL_ERROR;
     }
 
-    if (HAL_QSPI_Receive(hqspi, dest, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    // The whole array is one command, and faster than erasing each sector
+    if ((start == 0) && (length == CYPRESS_FLASH_SIZE))
     {
-        return HAL_ERROR;
+        plan->BulkErase = 1;
+        plan->EstimatedTime = BULK_ERASE_TYP_TIME;
+        return HAL_OK;
+    }
+
+    while (address < (start + length))
+    {
+        size = Cypress_QSPI_GetBlockSize(address, paramStart);
+
+        // Erasing a partial block would destroy data outside the range
+        if ((address & (size - 1)) || ((address + size) > (start + length)))
+        {
+            return HAL_ERROR;
+        }
+
+        if (size == CYPRESS_PARAM_SECTOR_SIZE)
+        {
+            plan->ParameterErases++;
+            plan->EstimatedTime += PARAM_SECTOR_ERASE_TYP_TIME;
+        }
+        else
+        {
+            plan->SectorErases++;
+            plan->EstimatedTime += SECTOR_ERASE_TYP_TIME;
+        }
+
+        address += size;
     }
 
     return HAL_OK;
 }
 
 /**
-* @brief   Reads data into memory using QSPI (blocking)
-* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
-* @pre     The latency codes must be set appropriately, \ref QSPI_DUMMY
+* @brief   Works out the erases \ref Cypress_QSPI_EraseRange would do for a range
 * @param   hqspi: QSPI handle
-* @param   address: starting address to read
-* @param   dest: pointer to memory destination
-* @param   count: bytes to read
-* @return  HAL status
-* @note    This is an alternate version of ReadQuad that only uses one line for the address and no mode bits
+* @param   start: first address to erase, on an erase block boundary
+* @param   length: bytes to erase, ending on an erase block boundary
+* @param   plan: Location to store the plan
+* @return  HAL status, HAL_ERROR if the range is empty or does not line up with erase blocks
+* @note    Use \ref Cypress_QSPI_GetEraseBlock to round a range out to erase blocks
 */
 
-HAL_StatusTypeDef Cypress_QSPI_ReadQuadAlt(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+HAL_StatusTypeDef Cypress_QSPI_PlanEraseRange(QSPI_HandleTypeDef *hqspi, uint32_t start, uint32_t length, Cypress_QSPI_ErasePlan *plan)
 {
-    QSPI_CommandTypeDef sCommand;
+    uint32_t paramStart;
+
+    if (Cypress_QSPI_GetParamStart(hqspi, &paramStart) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
 
-    sCommand.Instruction        = QUAD_OUT_FAST_READ_4_BYTE_ADDR_CMD;
-    sCommand.Address            = address;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = CYPRESS_DUMMY_CLOCK_CYCLES_READ_QUAD;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_1_LINE;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode           = QSPI_DATA_4_LINES;
-    sCommand.NbData             = count;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
+    return Cypress_QSPI_PlanErase(start, length, paramStart, plan);
+}
 
-    if  (HAL_QSPI_Command(hqspi, &sCommand, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+/**
+* @brief   Sets all bits in a 4 KB parameter sector to 1 (blocking)
+* @param   hqspi: QSPI handle
+* @param   address: address within the parameter sector to erase
+* @return  HAL status, HAL_ERROR if the address is not in a parameter sector
+* @note    The S25FL512S has uniform sectors and no parameter sectors; the S25FL128S and S25FL256S have 32
+*          when configured for 64 KB sectors. See \ref Cypress_QSPI_GetEraseBlock.
+* @post    If error, call Cypress_QSPI_ErrorRecovery to clear errors
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ParameterErase(QSPI_HandleTypeDef *hqspi, uint32_t address)
+{
+    uint32_t size;
+
+    // The device ignores the command outside the parameter sectors, so catch that here
+    if (Cypress_QSPI_GetEraseBlock(hqspi, &address, &size) != HAL_OK)
     {
         return HAL_ERROR;
     }
 
-    if (HAL_QSPI_Receive(hqspi, dest, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    if (size != CYPRESS_PARAM_SECTOR_SIZE)
+    {
+        return HAL_ERROR;
+    }
+
+    CACHE_INVALIDATE(address, CYPRESS_PARAM_SECTOR_SIZE);
+    WRITE_COMBINE_DISCARD(address, CYPRESS_PARAM_SECTOR_SIZE);
+    PREFETCH_INVALIDATE(hqspi);
+
+    Cypress_QSPI_WriteEnable(hqspi);
+
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_PARAM_ERASE, address, 0) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    // Wait for the erase to complete
+    if  (Cypress_QSPI_WaitMemReady(hqspi, PARAM_SECTOR_ERASE_MAX_TIME) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    // Verify the erase worked properly
+    if  (Cypress_QSPI_CheckForErrors(hqspi) != HAL_OK)
     {
         return HAL_ERROR;
     }
@@ -996,42 +1253,42 @@ HAL_StatusTypeDef Cypress_QSPI_ReadQuadAlt(QSPI_HandleTypeDef *hqspi, uint32_t a
 }
 
 /**
-* @brief   Reads data into memory using QSPI (nonblocking, requires callbacks)
-* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
+* @brief   Sets all bits in a 4 KB parameter sector to 1 (non-blocking, requires interrupts)
 * @param   hqspi: QSPI handle
-* @param   address: starting address to read
-* @param   dest: pointer to memory destination
-* @param   count: bytes to read
-* @return  HAL status
-* @remark  Calls HAL_QSPI_RxCpltCallback on completion via interrupt
+* @param   address: address within the parameter sector to erase
+* @return  HAL status, HAL_ERROR if the address is not in a parameter sector
+* @post    User should verify that no errors occurred after erase
+* @remark  Calls HAL_QSPI_StatusMatchCallback when complete via interrupt
 */
 
-HAL_StatusTypeDef Cypress_QSPI_ReadQuad_IT(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+HAL_StatusTypeDef Cypress_QSPI_ParameterErase_IT(QSPI_HandleTypeDef *hqspi, uint32_t address)
 {
-    QSPI_CommandTypeDef sCommand;
+    uint32_t size;
 
-    sCommand.Instruction        = QUAD_INOUT_FAST_READ_4_BYTE_ADDR_CMD;
-    sCommand.Address            = address;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = CYPRESS_DUMMY_CLOCK_CYCLES_READ_QUADIO;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_4_LINES;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_4_LINES;
-    sCommand.DataMode           = QSPI_DATA_4_LINES;
-    sCommand.NbData             = count;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
+    // The device ignores the command outside the parameter sectors, so catch that here
+    if (Cypress_QSPI_GetEraseBlock(hqspi, &address, &size) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
 
-    if  (HAL_QSPI_Command(hqspi, &sCommand, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    if (size != CYPRESS_PARAM_SECTOR_SIZE)
     {
         return HAL_ERROR;
     }
 
-    // This will call HAL_QSPI_RxCpltCallback when complete
-    if (HAL_QSPI_Receive_IT(hqspi, dest) != HAL_OK)
+    CACHE_INVALIDATE(address, CYPRESS_PARAM_SECTOR_SIZE);
+    WRITE_COMBINE_DISCARD(address, CYPRESS_PARAM_SECTOR_SIZE);
+    PREFETCH_INVALIDATE(hqspi);
+
+    Cypress_QSPI_WriteEnable(hqspi);
+
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_PARAM_ERASE, address, 0) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    // This will call HAL_QSPI_StatusMatchCallback when complete
+    if  (Cypress_QSPI_WaitMemReady_IT(hqspi) != HAL_OK)
     {
         return HAL_ERROR;
     }
@@ -1040,43 +1297,31 @@ HAL_StatusTypeDef Cypress_QSPI_ReadQuad_IT(QSPI_HandleTypeDef *hqspi, uint32_t a
 }
 
 /**
-* @brief   Reads data directly into memory using QSPI (nonblocking, requires callbacks)
-* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
+* @brief   Sets *all* bits in the flash memory to 1 (blocking)
 * @param   hqspi: QSPI handle
-* @param   address: starting address to read
-* @param   dest: pointer to memory destination
-* @param   count: bytes to read
 * @return  HAL status
-* @remark  Calls HAL_QSPI_RxCpltCallback on completion via interrupt
+* @post    If error, call Cypress_QSPI_ErrorRecovery to clear errors
 */
 
-HAL_StatusTypeDef Cypress_QSPI_ReadQuad_DMA(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+HAL_StatusTypeDef Cypress_QSPI_BulkErase(QSPI_HandleTypeDef *hqspi)
 {
-    QSPI_CommandTypeDef sCommand;
+    CACHE_INVALIDATE_ALL();
+    WRITE_COMBINE_DISCARD(0, 0);
+    PREFETCH_INVALIDATE(hqspi);
 
-    sCommand.Instruction        = QUAD_INOUT_FAST_READ_4_BYTE_ADDR_CMD;
-    sCommand.Address            = address;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = CYPRESS_DUMMY_CLOCK_CYCLES_READ_QUADIO;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_4_LINES;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_4_LINES;
-    sCommand.DataMode           = QSPI_DATA_4_LINES;
-    sCommand.NbData             = count;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
+    Cypress_QSPI_WriteEnable(hqspi);
 
-    if  (HAL_QSPI_Command(hqspi, &sCommand, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_BULK_ERASE, 0, 0) != HAL_OK)
     {
         return HAL_ERROR;
     }
 
-    // This will call HAL_QSPI_RxCpltCallback when complete
-    if (HAL_QSPI_Receive_DMA(hqspi, dest) != HAL_OK)
+    if  (Cypress_QSPI_WaitMemReady(hqspi, BULK_ERASE_MAX_TIME))
+
+    // If any block protection bits are set, this will fail!
+    if  (Cypress_QSPI_CheckForErrors(hqspi) != HAL_OK)
     {
+        // If failed, SR1 should be cleared to recover
         return HAL_ERROR;
     }
 
@@ -1084,190 +1329,134 @@ HAL_StatusTypeDef Cypress_QSPI_ReadQuad_DMA(QSPI_HandleTypeDef *hqspi, uint32_t
 }
 
 /**
-* @brief   Writes data into a page in SPI mode (blocking)
+* @brief   Sets *all* bits in the flash memory to 1 (non-blocking, requires interrupts)
 * @param   hqspi: QSPI handle
-* @param   address: page to write
-* @param   src: pointer to data to write
-* @param   count: bytes to write
 * @return  HAL status
+* @post    User should verify that no errors occurred after erase
+* @remark  Calls HAL_QSPI_StatusMatchCallback when complete via interrupt
 */
 
-HAL_StatusTypeDef Cypress_QSPI_Program(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count)
+HAL_StatusTypeDef Cypress_QSPI_BulkErase_IT(QSPI_HandleTypeDef *hqspi)
 {
-    Cypress_QSPI_WriteEnable(hqspi);
-
-    QSPI_CommandTypeDef sCommand;
+    CACHE_INVALIDATE_ALL();
+    WRITE_COMBINE_DISCARD(0, 0);
+    PREFETCH_INVALIDATE(hqspi);
 
-    sCommand.Instruction        = PAGE_PROG_4_BYTE_ADDR_CMD;
-    sCommand.Address            = address;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = 0;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_1_LINE;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode           = QSPI_DATA_1_LINE;
-    sCommand.NbData             = count;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
+    Cypress_QSPI_WriteEnable(hqspi);
 
-    if  (HAL_QSPI_Command(hqspi, &sCommand, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_BULK_ERASE, 0, 0) != HAL_OK)
     {
         return HAL_ERROR;
     }
 
-    if (HAL_QSPI_Transmit(hqspi, src, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    // This will call HAL_QSPI_StatusMatchCallback when complete
+    if  (Cypress_QSPI_WaitMemReady_IT(hqspi) != HAL_OK)
     {
         return HAL_ERROR;
     }
 
-    // Verify no errors occured during the write
-    if  (Cypress_QSPI_CheckForErrors(hqspi) != HAL_OK) {
-        return HAL_ERROR;
-    }
-
+    // User should verify that no errors were raised after the callback occurs
+    // e.g. if any block protection is set, this will fail
     return HAL_OK;
 }
 
 /**
-* @brief   Writes data into a page in SPI mode (nonblocking, requires callbacks)
+* @brief   Suspends a page program in progress (blocking)
 * @param   hqspi: QSPI handle
-* @param   address: page to write
-* @param   src: pointer to data to write
-* @param   count: bytes to write
 * @return  HAL status
-* @post    User should verify that no errors were raised after the write
-* @remark  Calls HAL_QSPI_TxCpltCallback on completion via interrupt
+* @note    Does nothing if no program is in progress. Check SR2_PS to see whether a program was suspended.
+* @note    While suspended, any page except the one being programmed can be read
 */
 
-HAL_StatusTypeDef Cypress_QSPI_Program_IT(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count)
+HAL_StatusTypeDef Cypress_QSPI_ProgramSuspend(QSPI_HandleTypeDef *hqspi)
 {
-    Cypress_QSPI_WriteEnable(hqspi);
+    uint8_t statusRegister;
 
-    QSPI_CommandTypeDef sCommand;
+    if (Cypress_QSPI_ReadSR1(hqspi, &statusRegister) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
 
-    sCommand.Instruction        = PAGE_PROG_4_BYTE_ADDR_CMD;
-    sCommand.Address            = address;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = 0;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_1_LINE;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode           = QSPI_DATA_1_LINE;
-    sCommand.NbData             = count;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
+    if (!(statusRegister & SR1_WIP))
+    {
+        return HAL_OK;
+    }
 
-    if  (HAL_QSPI_Command(hqspi, &sCommand, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_PROGRAM_SUSPEND, 0, 0) != HAL_OK)
     {
         return HAL_ERROR;
     }
 
-    // This will call HAL_QSPI_TxCpltCallback when complete
-    if (HAL_QSPI_Transmit_IT(hqspi, src) != HAL_OK)
+    // WIP clears once the program is suspended, or if it finished first
+    if (Cypress_QSPI_WaitMemReady(hqspi, SUSPEND_MAX_TIME) != HAL_OK)
     {
         return HAL_ERROR;
     }
-    // User should verify after the callback that no errors were raised
 
     return HAL_OK;
 }
 
 /**
-* @brief   Writes data into a page in SPI mode (nonblocking, requires callbacks)
+* @brief   Resumes a suspended page program
 * @param   hqspi: QSPI handle
-* @param   address: page to write
-* @param   src: pointer to data to write
-* @param   count: bytes to write
 * @return  HAL status
-* @post    User should verify that no errors were raised after the write
-* @remark  Calls HAL_QSPI_TxCpltCallback on completion via interrupt
+* @note    Does nothing if SR2_PS is not set
 */
 
-HAL_StatusTypeDef Cypress_QSPI_Program_DMA(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count)
+HAL_StatusTypeDef Cypress_QSPI_ProgramResume(QSPI_HandleTypeDef *hqspi)
 {
-    Cypress_QSPI_WriteEnable(hqspi);
-
-    QSPI_CommandTypeDef sCommand;
-
-    sCommand.Instruction        = PAGE_PROG_4_BYTE_ADDR_CMD;
-    sCommand.Address            = address;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = 0;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_1_LINE;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode           = QSPI_DATA_1_LINE;
-    sCommand.NbData             = count;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
+    uint8_t statusRegister;
 
-    if  (HAL_QSPI_Command(hqspi, &sCommand, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    if (Cypress_QSPI_ReadSR2(hqspi, &statusRegister) != HAL_OK)
     {
         return HAL_ERROR;
     }
 
-    // This will call HAL_QSPI_TxCpltCallback when complete
-    if (HAL_QSPI_Transmit_DMA(hqspi, src) != HAL_OK)
+    if (!(statusRegister & SR2_PS))
+    {
+        return HAL_OK;
+    }
+
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_PROGRAM_RESUME, 0, 0) != HAL_OK)
     {
         return HAL_ERROR;
     }
-    // User should verify after the callback that no errors were raised
 
     return HAL_OK;
 }
 
 /**
-* @brief   Writes data into a page using QSPI (blocking)
-* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
+* @brief   Stops a WIP auto-poll in flight so other commands can be sent
 * @param   hqspi: QSPI handle
-* @param   address: page to write
-* @param   src: pointer to data to write
-* @param   count: bytes to write
-* @return  HAL status
+* @param   stopped: set to 1 if a poll was stopped and must be restarted with \ref Cypress_QSPI_WaitMemReady_IT
+* @return  HAL status, HAL_BUSY if another transfer is in progress
 */
 
-HAL_StatusTypeDef Cypress_QSPI_ProgramQuad(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count)
+static HAL_StatusTypeDef Cypress_QSPI_StopStatusPoll(QSPI_HandleTypeDef *hqspi, uint8_t *stopped)
 {
-    Cypress_QSPI_WriteEnable(hqspi);
+    HAL_QSPI_StateTypeDef state;
+    uint32_t primask;
 
-    QSPI_CommandTypeDef sCommand;
+    *stopped = 0;
 
-    sCommand.Instruction        = QUAD_IN_FAST_PROG_4_BYTE_ADDR_CMD;
-    sCommand.Address            = address;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = 0;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_1_LINE;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode           = QSPI_DATA_4_LINES;
-    sCommand.NbData             = count;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
+    // Keep the StatusMatch interrupt from firing between the check and the abort
+    primask = Cypress_QSPI_EnterCritical();
+    state = HAL_QSPI_GetState(hqspi);
 
-    if  (HAL_QSPI_Command(hqspi, &sCommand, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    if (state == HAL_QSPI_STATE_BUSY_AUTO_POLLING)
     {
-        return HAL_ERROR;
+        __HAL_QSPI_DISABLE_IT(hqspi, QSPI_IT_SM);
+        *stopped = 1;
     }
+    Cypress_QSPI_ExitCritical(primask);
 
-    if (HAL_QSPI_Transmit(hqspi, src, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    if (!*stopped)
     {
-        return HAL_ERROR;
+        return (state == HAL_QSPI_STATE_READY) ? HAL_OK : HAL_BUSY;
     }
 
-    // Verify no errors occured during the write
-    if  (Cypress_QSPI_CheckForErrors(hqspi) != HAL_OK) {
+    if (HAL_QSPI_Abort(hqspi) != HAL_OK)
+    {
         return HAL_ERROR;
     }
 
@@ -1275,127 +1464,107 @@ HAL_StatusTypeDef Cypress_QSPI_ProgramQuad(QSPI_HandleTypeDef *hqspi, uint32_t a
 }
 
 /**
-* @brief   Writes data into a page using QSPI (non-blocking, requires callbacks)
+* @brief   Reads data while a page program may be in progress, suspending it for the read (blocking)
 * @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
 * @param   hqspi: QSPI handle
-* @param   address: page to write
-* @param   src: pointer to data to write
-* @param   count: bytes to write
-* @return  HAL status
-* @post    User should verify that no errors were raised after the write
-* @remark  Calls HAL_QSPI_TxCpltCallback on completion via interrupt
+* @param   address: starting address to read, outside the page being programmed
+* @param   dest: pointer to memory destination
+* @param   count: bytes to read
+* @return  HAL status, HAL_BUSY if a program is still being sent to the flash
+* @note    A WIP auto-poll from \ref Cypress_QSPI_WaitMemReady_IT is stopped for the read and started again after the
+*          resume, so the StatusMatch callback still arrives once the program finishes
 */
 
-HAL_StatusTypeDef Cypress_QSPI_ProgramQuad_IT(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count)
+HAL_StatusTypeDef Cypress_QSPI_ReadQuadDuringProgram(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
 {
-    Cypress_QSPI_WriteEnable(hqspi);
+    HAL_StatusTypeDef status;
+    uint8_t repoll;
 
-    QSPI_CommandTypeDef sCommand;
+    status = Cypress_QSPI_StopStatusPoll(hqspi, &repoll);
 
-    sCommand.Instruction        = QUAD_IN_FAST_PROG_4_BYTE_ADDR_CMD;
-    sCommand.Address            = address;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = 0;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_1_LINE;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode           = QSPI_DATA_4_LINES;
-    sCommand.NbData             = count;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
+    if (status != HAL_OK)
+    {
+        return status;
+    }
 
-    if  (HAL_QSPI_Command(hqspi, &sCommand, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    if (Cypress_QSPI_ProgramSuspend(hqspi) != HAL_OK)
     {
         return HAL_ERROR;
     }
 
-    // This will call HAL_QSPI_TxCpltCallback when complete
-    if (HAL_QSPI_Transmit_IT(hqspi, src) != HAL_OK)
+    status = Cypress_QSPI_ReadQuad(hqspi, address, dest, count);
+
+    if (Cypress_QSPI_ProgramResume(hqspi) != HAL_OK)
     {
         return HAL_ERROR;
     }
-    // User should verify after the callback that no errors were raised
 
-    return HAL_OK;
+    if (repoll && (Cypress_QSPI_WaitMemReady_IT(hqspi) != HAL_OK))
+    {
+        return HAL_ERROR;
+    }
+
+    return status;
 }
 
 /**
-* @brief   Writes data into a page using QSPI (non-blocking, requires callbacks)
-* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
+* @brief   Suspends a sector erase in progress (blocking)
 * @param   hqspi: QSPI handle
-* @param   address: page to write
-* @param   src: pointer to data to write
-* @param   count: bytes to write
 * @return  HAL status
-* @post    User should verify that no errors were raised after the write
-* @remark  Calls HAL_QSPI_TxCpltCallback on completion via interrupt
+* @note    Does nothing if no erase is in progress. Check SR2_ES to see whether an erase was suspended.
+* @note    While suspended, any sector except the one being erased can be read or programmed
 */
 
-HAL_StatusTypeDef Cypress_QSPI_ProgramQuad_DMA(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count)
+HAL_StatusTypeDef Cypress_QSPI_EraseSuspend(QSPI_HandleTypeDef *hqspi)
 {
-    Cypress_QSPI_WriteEnable(hqspi);
+    uint8_t statusRegister;
 
-    QSPI_CommandTypeDef sCommand;
+    if (Cypress_QSPI_ReadSR1(hqspi, &statusRegister) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
 
-    sCommand.Instruction        = QUAD_IN_FAST_PROG_4_BYTE_ADDR_CMD;
-    sCommand.Address            = address;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = 0;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_1_LINE;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode           = QSPI_DATA_4_LINES;
-    sCommand.NbData             = count;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
+    if (!(statusRegister & SR1_WIP))
+    {
+        return HAL_OK;
+    }
 
-    if  (HAL_QSPI_Command(hqspi, &sCommand, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_ERASE_SUSPEND, 0, 0) != HAL_OK)
     {
         return HAL_ERROR;
     }
 
-    // This will call HAL_QSPI_TxCpltCallback when complete
-    if (HAL_QSPI_Transmit_DMA(hqspi, src) != HAL_OK)
+    // WIP clears once the erase is suspended, or if it finished first
+    if (Cypress_QSPI_WaitMemReady(hqspi, SUSPEND_MAX_TIME) != HAL_OK)
     {
         return HAL_ERROR;
     }
-    // User should verify after the callback that no errors were raised
 
     return HAL_OK;
 }
 
 /**
-* @brief   Resets device to power-up state
+* @brief   Resumes a suspended sector erase
 * @param   hqspi: QSPI handle
 * @return  HAL status
+* @note    Does nothing if SR2_ES is not set
 */
 
-HAL_StatusTypeDef Cypress_QSPI_Reset(QSPI_HandleTypeDef *hqspi)
+HAL_StatusTypeDef Cypress_QSPI_EraseResume(QSPI_HandleTypeDef *hqspi)
 {
-    QSPI_CommandTypeDef     sCommand;
+    uint8_t statusRegister;
+
+    if (Cypress_QSPI_ReadSR2(hqspi, &statusRegister) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
 
-    sCommand.Instruction        = SOFTWARE_RESET_CMD;
-    sCommand.Address            = 0;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = 0;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_NONE;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode           = QSPI_DATA_NONE;
-    sCommand.NbData             = 0;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
+    if (!(statusRegister & SR2_ES))
+    {
+        return HAL_OK;
+    }
 
-    if (HAL_QSPI_Command(hqspi, &sCommand, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_ERASE_RESUME, 0, 0) != HAL_OK)
     {
         return HAL_ERROR;
     }
@@ -1403,83 +1572,4468 @@ HAL_StatusTypeDef Cypress_QSPI_Reset(QSPI_HandleTypeDef *hqspi)
     return HAL_OK;
 }
 
+#if (USE_HAL_QSPI_REGISTER_CALLBACKS == 1)
 /**
-* @brief   Forces device into normal mode after continuous high performance read mode
+* @brief   Ends a managed erase and gives the QSPI callbacks back to the application
+* @param   hqspi: QSPI handle
+* @param   status: final status passed to the completion callback
+*/
+
+static void Cypress_QSPI_EraseManagerFinish(QSPI_HandleTypeDef *hqspi, HAL_StatusTypeDef status)
+{
+    HAL_QSPI_RegisterCallback(hqspi, HAL_QSPI_STATUS_MATCH_CB_ID, eraseManager.SavedStatusMatch);
+    HAL_QSPI_RegisterCallback(hqspi, HAL_QSPI_ERROR_CB_ID, eraseManager.SavedError);
+    eraseManager.Status = status;
+
+    if (eraseManager.Callback != NULL)
+    {
+        eraseManager.Callback(status);
+    }
+}
+
+/**
+* @brief   Starts erasing the next block of a managed erase (nonblocking)
 * @param   hqspi: QSPI handle
 * @return  HAL status
 */
 
-HAL_StatusTypeDef Cypress_QSPI_ModeBitReset(QSPI_HandleTypeDef *hqspi)
+static HAL_StatusTypeDef Cypress_QSPI_EraseManagerNext(QSPI_HandleTypeDef *hqspi)
 {
-    QSPI_CommandTypeDef     sCommand;
+    eraseManager.Sector = eraseManager.Next;
+    // Let each block run for a full interval before the first suspend
+    eraseManager.LastResume = HAL_GetTick();
+
+    if (eraseManager.Bulk)
+    {
+        // Cannot be suspended, and covers every address
+        eraseManager.SectorSize = CYPRESS_FLASH_SIZE;
+        eraseManager.Next = eraseManager.End;
+        return Cypress_QSPI_BulkErase_IT(hqspi);
+    }
 
-    sCommand.Instruction        = MODE_BIT_RESET_CMD;
-    sCommand.Address            = 0;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = 0;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_NONE;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode           = QSPI_DATA_NONE;
-    sCommand.NbData             = 0;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
+    eraseManager.SectorSize = Cypress_QSPI_GetBlockSize(eraseManager.Next, eraseManager.ParamStart);
+    eraseManager.Next += eraseManager.SectorSize;
 
-    if (HAL_QSPI_Command(hqspi, &sCommand, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    if (eraseManager.SectorSize == CYPRESS_PARAM_SECTOR_SIZE)
     {
-        return HAL_ERROR;
+        return Cypress_QSPI_ParameterErase_IT(hqspi, eraseManager.Sector);
     }
 
-    return HAL_OK;
+    return Cypress_QSPI_SectorErase_IT(hqspi, eraseManager.Sector);
 }
 
 /**
-* @brief   Sets all configuration to default
-* @warn    This will unset the QUAD bit and may result in write protection being set; see \ref Cypress_QSPI_DisableWP
+* @brief   StatusMatch callback while a managed erase is running, flags the block as done
 * @param   hqspi: QSPI handle
-* @return  HAL status
+* @note    The error check and the next block are left to \ref Cypress_QSPI_EraseManagerStep, outside the interrupt
 */
 
-HAL_StatusTypeDef Cypress_QSPI_ResetConfiguration(QSPI_HandleTypeDef *hqspi)
+static void Cypress_QSPI_EraseManagerStatusMatch(QSPI_HandleTypeDef *hqspi)
 {
-    Cypress_QSPI_WriteEnable(hqspi);
+    (void)hqspi;
+    eraseManager.BlockDone = 1;
+}
 
-    QSPI_CommandTypeDef sCommand;
-    uint8_t defaultConfig[] = { 0U, 0U };
+/**
+* @brief   Checks a finished block of a managed erase and starts the next one (blocking)
+* @param   hqspi: QSPI handle
+* @return  HAL status, HAL_ERROR if the block failed or the next one could not be started
+* @note    Does nothing until the StatusMatch callback has flagged the block as done
+*/
+
+static HAL_StatusTypeDef Cypress_QSPI_EraseManagerStep(QSPI_HandleTypeDef *hqspi)
+{
+    if ((eraseManager.Status != HAL_BUSY) || (eraseManager.BlockDone == 0))
+    {
+        return HAL_OK;
+    }
 
-    sCommand.Instruction        = WRITE_STATUS_CMD_REG_CMD;
-    sCommand.Address            = 0;
-    sCommand.AlternateBytes     = 0;
-    sCommand.AddressSize        = QSPI_ADDRESS_32_BITS;
-    sCommand.AlternateBytesSize = QSPI_ALTERNATE_BYTES_8_BITS;
-    sCommand.DummyCycles        = 0;
-    sCommand.InstructionMode    = QSPI_INSTRUCTION_1_LINE;
-    sCommand.AddressMode        = QSPI_ADDRESS_NONE;
-    sCommand.AlternateByteMode  = QSPI_ALTERNATE_BYTES_NONE;
-    sCommand.DataMode           = QSPI_DATA_1_LINE;
-    sCommand.NbData             = 2;
-    sCommand.DdrMode            = QSPI_DDR_MODE_DISABLE;
-    sCommand.DdrHoldHalfCycle   = QSPI_DDR_HHC_ANALOG_DELAY;
-    sCommand.SIOOMode           = QSPI_SIOO_INST_EVERY_CMD;
+    eraseManager.BlockDone = 0;
 
-    if (HAL_QSPI_Command(hqspi, &sCommand, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    // E_ERR is only valid once the erase has finished
+    if (Cypress_QSPI_CheckForErrors(hqspi) != HAL_OK)
     {
+        Cypress_QSPI_EraseManagerFinish(hqspi, HAL_ERROR);
         return HAL_ERROR;
     }
 
-    if (HAL_QSPI_Transmit(hqspi, defaultConfig, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    eraseManager.Stats.Erases++;
+    eraseManager.Done += (eraseManager.Bulk) ? eraseManager.Total : eraseManager.SectorSize;
+
+    if (eraseManager.Progress != NULL)
     {
-        return HAL_ERROR;
+        eraseManager.Progress(eraseManager.Done, eraseManager.Total);
     }
 
-    Cypress_QSPI_WaitMemReady(hqspi, HAL_QSPI_TIMEOUT_DEFAULT_VALUE);
+    if (eraseManager.Next >= eraseManager.End)
+    {
+        Cypress_QSPI_EraseManagerFinish(hqspi, HAL_OK);
+        return HAL_OK;
+    }
+
+    if (Cypress_QSPI_EraseManagerNext(hqspi) != HAL_OK)
+    {
+        Cypress_QSPI_EraseManagerFinish(hqspi, HAL_ERROR);
+        return HAL_ERROR;
+    }
 
     return HAL_OK;
 }
 
+/**
+* @brief   Error callback while a managed erase is running
+* @param   hqspi: QSPI handle
+* @remark  The application's error callback is still called
+*/
+
+static void Cypress_QSPI_EraseManagerError(QSPI_HandleTypeDef *hqspi)
+{
+    Cypress_QSPI_EraseManagerFinish(hqspi, HAL_ERROR);
+    eraseManager.SavedError(hqspi);
+}
+
+/**
+* @brief   Borrows the QSPI callbacks and starts a managed erase of a block aligned range (nonblocking)
+* @param   hqspi: QSPI handle
+* @param   start: first address to erase
+* @param   end: address after the last byte to erase
+* @param   bulk: 1 to erase the whole array with one bulk erase
+* @param   paramStart: address of the first parameter sector, from \ref Cypress_QSPI_GetParamStart
+* @param   progress: called after each block, may be NULL
+* @param   callback: called once when the range is erased, may be NULL
+* @return  HAL status
+*/
+
+static HAL_StatusTypeDef Cypress_QSPI_EraseManagerStart(QSPI_HandleTypeDef *hqspi, uint32_t start, uint32_t end, uint8_t bulk,
+                                                        uint32_t paramStart, Cypress_QSPI_ProgressCallback progress, Cypress_QSPI_CompleteCallback callback)
+{
+    eraseManager.Next = start;
+    eraseManager.End = end;
+    eraseManager.Done = 0;
+    eraseManager.Total = end - start;
+    eraseManager.Bulk = bulk;
+    eraseManager.ParamStart = paramStart;
+    eraseManager.BlockDone = 0;
+    eraseManager.Progress = progress;
+    eraseManager.Callback = callback;
+    eraseManager.SavedStatusMatch = hqspi->StatusMatchCallback;
+    eraseManager.SavedError = hqspi->ErrorCallback;
+
+    if ((HAL_QSPI_RegisterCallback(hqspi, HAL_QSPI_STATUS_MATCH_CB_ID, Cypress_QSPI_EraseManagerStatusMatch) != HAL_OK) ||
+        (HAL_QSPI_RegisterCallback(hqspi, HAL_QSPI_ERROR_CB_ID, Cypress_QSPI_EraseManagerError) != HAL_OK))
+    {
+        eraseManager.Callback = NULL;
+        Cypress_QSPI_EraseManagerFinish(hqspi, HAL_ERROR);
+        return HAL_ERROR;
+    }
+
+    eraseManager.Status = HAL_BUSY;
+
+    if (Cypress_QSPI_EraseManagerNext(hqspi) != HAL_OK)
+    {
+        // Nothing was started, so the callback is not called
+        eraseManager.Callback = NULL;
+        Cypress_QSPI_EraseManagerFinish(hqspi, HAL_ERROR);
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Starts an erase of one block that \ref Cypress_QSPI_ManagedRead can suspend (nonblocking)
+* @pre     Register callbacks must be enabled for QUADSPI
+* @param   hqspi: QSPI handle
+* @param   address: address within the sector to erase
+* @param   callback: called once when the erase is done, may be NULL
+* @return  HAL status
+* @note    Erases the parameter sector instead if the address is in one, see \ref Cypress_QSPI_GetEraseBlock
+* @note    The erase only completes once \ref Cypress_QSPI_ServiceManagedErase, or another managed call, runs after
+*          the StatusMatch interrupt. The callback is called from there, or from the interrupt on a peripheral error.
+* @remark  The StatusMatch and Error callbacks are borrowed until the erase is done
+* @post    If error, call Cypress_QSPI_ErrorRecovery to clear errors
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ManagedErase(QSPI_HandleTypeDef *hqspi, uint32_t address, Cypress_QSPI_CompleteCallback callback)
+{
+    uint32_t paramStart;
+    uint32_t size;
+
+    if (eraseManager.Status == HAL_BUSY)
+    {
+        return HAL_BUSY;
+    }
+
+    if (Cypress_QSPI_GetParamStart(hqspi, &paramStart) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    size = Cypress_QSPI_GetBlockSize(address, paramStart);
+    address &= ~(size - 1);
+
+    return Cypress_QSPI_EraseManagerStart(hqspi, address, address + size, 0, paramStart, NULL, callback);
+}
+
+/**
+* @brief   Erases a range with the fewest parameter sector, sector or bulk erases (nonblocking)
+* @pre     Register callbacks must be enabled for QUADSPI
+* @param   hqspi: QSPI handle
+* @param   start: first address to erase, on an erase block boundary
+* @param   length: bytes to erase, ending on an erase block boundary
+* @param   plan: Location to store the erases planned and their typical duration, may be NULL
+* @param   progress: called with the bytes erased so far after each block, may be NULL
+* @param   callback: called once when the range is erased, may be NULL
+* @return  HAL status, HAL_ERROR if the range does not line up with erase blocks
+* @note    Runs as a managed erase, so \ref Cypress_QSPI_ManagedRead and \ref Cypress_QSPI_ManagedProgram can use
+*          other blocks in the meantime. A bulk erase cannot be suspended and blocks all managed accesses.
+* @note    Each block is checked and the next one started by \ref Cypress_QSPI_ServiceManagedErase, which must be
+*          called from the main loop until the range is done. The callbacks run from there.
+* @remark  The StatusMatch and Error callbacks are borrowed until the erase is done
+* @post    If error, call Cypress_QSPI_ErrorRecovery to clear errors
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_EraseRange(QSPI_HandleTypeDef *hqspi, uint32_t start, uint32_t length, Cypress_QSPI_ErasePlan *plan,
+                                          Cypress_QSPI_ProgressCallback progress, Cypress_QSPI_CompleteCallback callback)
+{
+    Cypress_QSPI_ErasePlan localPlan;
+    uint32_t paramStart;
+
+    if (eraseManager.Status == HAL_BUSY)
+    {
+        return HAL_BUSY;
+    }
+
+    if (plan == NULL)
+    {
+        plan = &localPlan;
+    }
+
+    if (Cypress_QSPI_GetParamStart(hqspi, &paramStart) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_PlanErase(start, length, paramStart, plan) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    return Cypress_QSPI_EraseManagerStart(hqspi, start, start + length, plan->BulkErase, paramStart, progress, callback);
+}
+
+/**
+* @brief   Suspends a managed erase so other sectors can be accessed (blocking)
+* @param   hqspi: QSPI handle
+* @param   repoll: set to 1 if the WIP poll must be restarted by \ref Cypress_QSPI_EraseManagerResume
+* @param   suspended: set to 1 if the erase was suspended, 0 if it had already finished
+* @return  HAL status, HAL_BUSY if another transfer is in progress
+*/
+
+static HAL_StatusTypeDef Cypress_QSPI_EraseManagerSuspend(QSPI_HandleTypeDef *hqspi, uint8_t *repoll, uint8_t *suspended)
+{
+    HAL_StatusTypeDef status;
+    uint8_t statusRegister;
+
+    *suspended = 0;
+
+    status = Cypress_QSPI_StopStatusPoll(hqspi, repoll);
+
+    if (status != HAL_OK)
+    {
+        return status;
+    }
+
+    eraseManager.SuspendStart = HAL_GetTick();
+
+    if (Cypress_QSPI_EraseSuspend(hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_ReadSR2(hqspi, &statusRegister) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    *suspended = (statusRegister & SR2_ES) ? 1 : 0;
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Resumes a managed erase after \ref Cypress_QSPI_EraseManagerSuspend
+* @param   hqspi: QSPI handle
+* @param   repoll: value set by \ref Cypress_QSPI_EraseManagerSuspend
+* @param   suspended: value set by \ref Cypress_QSPI_EraseManagerSuspend
+* @return  HAL status
+*/
+
+static HAL_StatusTypeDef Cypress_QSPI_EraseManagerResume(QSPI_HandleTypeDef *hqspi, uint8_t repoll, uint8_t suspended)
+{
+    if (suspended)
+    {
+        if (Cypress_QSPI_EraseResume(hqspi) != HAL_OK)
+        {
+            return HAL_ERROR;
+        }
+
+        eraseManager.LastResume = HAL_GetTick();
+        eraseManager.Stats.Suspends++;
+        eraseManager.Stats.SuspendedTime += eraseManager.LastResume - eraseManager.SuspendStart;
+    }
+
+    // Also delivers the completion if the erase finished in the meantime
+    if (repoll && (Cypress_QSPI_WaitMemReady_IT(hqspi) != HAL_OK))
+    {
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Programs everything queued by \ref Cypress_QSPI_ManagedProgram (blocking)
+* @param   hqspi: QSPI handle
+* @param   suspended: 1 if an erase is suspended for the programs
+* @return  HAL status
+* @note    The queue is emptied even if a program fails
+*/
+
+static HAL_StatusTypeDef Cypress_QSPI_EraseManagerDrain(QSPI_HandleTypeDef *hqspi, uint8_t suspended)
+{
+    HAL_StatusTypeDef status = HAL_OK;
+
+    for (uint8_t i = 0; (i < eraseManager.Queued) && (status == HAL_OK); i++)
+    {
+        status = Cypress_QSPI_ProgramRange(hqspi, eraseManager.Queue[i].Address, eraseManager.Queue[i].Source, eraseManager.Queue[i].Count);
+
+        if (suspended)
+        {
+            eraseManager.Stats.Programs++;
+        }
+    }
+
+    eraseManager.Queued = 0;
+
+    return status;
+}
+
+/**
+* @brief   Checks an access against the part of the managed erase range that is not done yet
+* @param   address: starting address of the access
+* @param   count: bytes accessed
+* @return  1 if the access overlaps the block being erased or a block still to be erased, else 0
+* @note    Data accessed now in a later block would be lost or read back as erased once that block is reached
+*/
+
+static uint8_t Cypress_QSPI_EraseManagerOverlaps(uint32_t address, uint32_t count)
+{
+    uint32_t end = eraseManager.Sector + eraseManager.SectorSize;
+
+    if (eraseManager.End > end)
+    {
+        end = eraseManager.End;
+    }
+
+    return ((address < end) && ((address + count) > eraseManager.Sector)) ? 1 : 0;
+}
+
+/**
+* @brief   Reads data, suspending a managed erase if one is in progress (blocking)
+* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
+* @param   hqspi: QSPI handle
+* @param   address: starting address to read, outside the blocks still to be erased
+* @param   dest: pointer to memory destination
+* @param   count: bytes to read
+* @return  HAL status, HAL_ERROR if the read overlaps the block being erased or one still to be erased
+* @note    To make sure the erase progresses, a suspend waits until CYPRESS_ERASE_MIN_RESUME_INTERVAL ms have passed
+*          since the erase started or was last resumed
+* @note    Programs queued by \ref Cypress_QSPI_ManagedProgram are done first, so the read returns their data
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ManagedRead(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+{
+    HAL_StatusTypeDef status;
+    uint8_t repoll;
+    uint8_t suspended;
+
+    if (Cypress_QSPI_EraseManagerStep(hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (eraseManager.Status != HAL_BUSY)
+    {
+        // Programs may still be queued from an erase that has since finished
+        if (Cypress_QSPI_ServiceManagedErase(hqspi) != HAL_OK)
+        {
+            return HAL_ERROR;
+        }
+
+        return Cypress_QSPI_ReadQuad(hqspi, address, dest, count);
+    }
+
+    if (Cypress_QSPI_EraseManagerOverlaps(address, count))
+    {
+        return HAL_ERROR;
+    }
+
+    while ((HAL_GetTick() - eraseManager.LastResume) < CYPRESS_ERASE_MIN_RESUME_INTERVAL)
+    {
+        // Give the erase time to progress
+    }
+
+    status = Cypress_QSPI_EraseManagerSuspend(hqspi, &repoll, &suspended);
+
+    if (status != HAL_OK)
+    {
+        return status;
+    }
+
+    status = Cypress_QSPI_EraseManagerDrain(hqspi, suspended);
+
+    if (status == HAL_OK)
+    {
+        status = Cypress_QSPI_ReadQuad(hqspi, address, dest, count);
+    }
+
+    if (Cypress_QSPI_EraseManagerResume(hqspi, repoll, suspended) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    return status;
+}
+
+/**
+* @brief   Programs data, queueing it while a managed erase is in progress
+* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
+* @param   hqspi: QSPI handle
+* @param   address: starting address to program, outside the blocks still to be erased
+* @param   src: pointer to data to write, must stay valid until the program is done
+* @param   count: bytes to write
+* @return  HAL status, HAL_ERROR if the program overlaps the block being erased or one still to be erased
+* @note    Without an erase running the data is programmed right away, as with \ref Cypress_QSPI_ProgramRange.
+*          Otherwise it is queued and programmed with the erase suspended by \ref Cypress_QSPI_ServiceManagedErase
+*          or \ref Cypress_QSPI_ManagedRead. Blocks only when the queue of CYPRESS_ERASE_PROGRAM_QUEUE is full.
+* @note    Data still queued when the erase finishes is programmed by the call that completes the erase, so keep
+*          calling Cypress_QSPI_ServiceManagedErase until it returns HAL_OK and the erase is no longer busy.
+* @post    If error, call Cypress_QSPI_ErrorRecovery to clear errors
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ManagedProgram(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count)
+{
+    HAL_StatusTypeDef status;
+
+    if (Cypress_QSPI_EraseManagerStep(hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (eraseManager.Status != HAL_BUSY)
+    {
+        // Keep the order of anything queued before the erase finished
+        if (Cypress_QSPI_ServiceManagedErase(hqspi) != HAL_OK)
+        {
+            return HAL_ERROR;
+        }
+
+        return Cypress_QSPI_ProgramRange(hqspi, address, src, count);
+    }
+
+    if (Cypress_QSPI_EraseManagerOverlaps(address, count))
+    {
+        return HAL_ERROR;
+    }
+
+    if (eraseManager.Queued == CYPRESS_ERASE_PROGRAM_QUEUE)
+    {
+        do
+        {
+            status = Cypress_QSPI_ServiceManagedErase(hqspi);
+        } while (status == HAL_BUSY);
+
+        if (status != HAL_OK)
+        {
+            return status;
+        }
+
+        // The erase may have finished while waiting
+        if (eraseManager.Status != HAL_BUSY)
+        {
+            return Cypress_QSPI_ProgramRange(hqspi, address, src, count);
+        }
+    }
+
+    eraseManager.Queue[eraseManager.Queued].Address = address;
+    eraseManager.Queue[eraseManager.Queued].Source = src;
+    eraseManager.Queue[eraseManager.Queued].Count = count;
+    eraseManager.Queued++;
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Advances a managed erase and programs queued data, suspending the erase if needed (blocking)
+* @param   hqspi: QSPI handle
+* @return  HAL status, HAL_BUSY if programs are still queued because the erase was resumed too recently
+* @note    Call from the main loop while an erase is running or programs are queued, including after the erase
+*          has finished. Finished blocks are checked and the next one is started here, never from the interrupt.
+* @post    If error, call Cypress_QSPI_ErrorRecovery to clear errors
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ServiceManagedErase(QSPI_HandleTypeDef *hqspi)
+{
+    HAL_StatusTypeDef status;
+    uint8_t repoll = 0;
+    uint8_t suspended = 0;
+
+    if (Cypress_QSPI_EraseManagerStep(hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (eraseManager.Queued == 0)
+    {
+        return HAL_OK;
+    }
+
+    if (eraseManager.Status == HAL_BUSY)
+    {
+        if ((HAL_GetTick() - eraseManager.LastResume) < CYPRESS_ERASE_MIN_RESUME_INTERVAL)
+        {
+            return HAL_BUSY;
+        }
+
+        status = Cypress_QSPI_EraseManagerSuspend(hqspi, &repoll, &suspended);
+
+        if (status != HAL_OK)
+        {
+            return status;
+        }
+    }
+
+    status = Cypress_QSPI_EraseManagerDrain(hqspi, suspended);
+
+    if (Cypress_QSPI_EraseManagerResume(hqspi, repoll, suspended) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    return status;
+}
+
+/**
+* @brief   Gets the state of the last managed erase
+* @return  HAL_BUSY while running, HAL_OK once the sector is erased, HAL_ERROR if it failed
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_GetManagedEraseStatus(void)
+{
+    return eraseManager.Status;
+}
+
+/**
+* @brief   Gets the erase manager counters
+* @param   stats: Location to store the counters
+*/
+
+void Cypress_QSPI_GetEraseStats(Cypress_QSPI_EraseStats *stats)
+{
+    *stats = eraseManager.Stats;
+}
+
+/**
+* @brief   Clears the erase manager counters
+*/
+
+void Cypress_QSPI_ResetEraseStats(void)
+{
+    eraseManager.Stats.Erases = 0;
+    eraseManager.Stats.Suspends = 0;
+    eraseManager.Stats.Programs = 0;
+    eraseManager.Stats.SuspendedTime = 0;
+}
+
+/**
+* @brief   Completion callback of a pool erase started by \ref Cypress_QSPI_PoolService
+* @param   status: result of the erase
+*/
+
+static void Cypress_QSPI_PoolEraseDone(HAL_StatusTypeDef status)
+{
+    uint32_t index = pool.Pending;
+
+    pool.Pending = POOL_NONE;
+
+    // A failed sector stays dirty and is tried again
+    if (status == HAL_OK)
+    {
+        POOL_SET(pool.Erased, index);
+        pool.Stats.Erased++;
+        pool.Stats.Dirty--;
+    }
+}
+
+/**
+* @brief   Sets up a pool of sectors kept erased in the background
+* @param   start: address of the first sector of the pool
+* @param   count: sectors in the pool
+* @param   target: erased sectors \ref Cypress_QSPI_PoolService keeps ready
+* @param   lowWatermark: claims leaving fewer erased sectors than this call the callback, 0 to disable
+* @param   callback: called from \ref Cypress_QSPI_PoolClaim when the watermark is crossed, may be NULL
+* @return  HAL status, HAL_ERROR if the pool is not inside the array or is being erased
+* @note    Every sector starts out dirty, i.e. waiting for an erase. The pool owns the sectors: only write to them
+*          after claiming them.
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_PoolInit(uint32_t start, uint32_t count, uint32_t target, uint32_t lowWatermark, Cypress_QSPI_PoolCallback callback)
+{
+    if ((start & (CYPRESS_SECTOR_SIZE - 1)) || (count == 0) || (count > POOL_MAX_SECTORS) ||
+        (start > (CYPRESS_FLASH_SIZE - (count * CYPRESS_SECTOR_SIZE))))
+    {
+        return HAL_ERROR;
+    }
+
+    if (pool.Pending != POOL_NONE)
+    {
+        return HAL_ERROR;
+    }
+
+    for (uint32_t i = 0; i < sizeof(pool.Erased); i++)
+    {
+        pool.Erased[i] = 0;
+        pool.InUse[i] = 0;
+    }
+
+    pool.Start = start;
+    pool.Count = count;
+    pool.Target = (target < count) ? target : count;
+    pool.LowWatermark = lowWatermark;
+    pool.Callback = callback;
+    pool.Cursor = 0;
+    pool.Stats.Erased = 0;
+    pool.Stats.InUse = 0;
+    pool.Stats.Dirty = count;
+    pool.Stats.Claims = 0;
+    pool.Stats.Misses = 0;
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Erases the next dirty sector of the pool if fewer than the target are erased (nonblocking)
+* @pre     Register callbacks must be enabled for QUADSPI
+* @param   hqspi: QSPI handle
+* @return  HAL status, HAL_BUSY while an erase is running, HAL_OK once the target is met or nothing is dirty
+* @note    Call from the idle loop. Erases go through the erase manager, so \ref Cypress_QSPI_ManagedRead and
+*          \ref Cypress_QSPI_ManagedProgram can still use other sectors while the pool is refilled.
+* @post    If error, call Cypress_QSPI_ErrorRecovery to clear errors
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_PoolService(QSPI_HandleTypeDef *hqspi)
+{
+    uint32_t index;
+
+    if (pool.Pending != POOL_NONE)
+    {
+        // Completes the pool erase once its block is done
+        if (Cypress_QSPI_ServiceManagedErase(hqspi) == HAL_ERROR)
+        {
+            return HAL_ERROR;
+        }
+
+        if (pool.Pending != POOL_NONE)
+        {
+            return HAL_BUSY;
+        }
+    }
+
+    if ((pool.Stats.Erased >= pool.Target) || (pool.Stats.Dirty == 0))
+    {
+        return HAL_OK;
+    }
+
+    // Start after the last sector erased to spread the wear over the pool
+    for (uint32_t i = 0; i < pool.Count; i++)
+    {
+        index = (pool.Cursor + i) % pool.Count;
+
+        if (!POOL_TEST(pool.Erased, index) && !POOL_TEST(pool.InUse, index))
+        {
+            pool.Pending = index;
+
+            if (Cypress_QSPI_ManagedErase(hqspi, pool.Start + (index * CYPRESS_SECTOR_SIZE), Cypress_QSPI_PoolEraseDone) != HAL_OK)
+            {
+                pool.Pending = POOL_NONE;
+                // HAL_BUSY if the erase manager is running an erase for someone else
+                return (eraseManager.Status == HAL_BUSY) ? HAL_BUSY : HAL_ERROR;
+            }
+
+            pool.Cursor = (index + 1) % pool.Count;
+            return HAL_BUSY;
+        }
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Takes an erased sector from the pool, ready to be programmed
+* @param   address: Location to store the address of the sector
+* @return  HAL status, HAL_ERROR if no sector is erased
+* @note    Safe to call while \ref Cypress_QSPI_PoolService has an erase running
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_PoolClaim(uint32_t *address)
+{
+    uint32_t erased;
+    uint32_t primask;
+
+    primask = Cypress_QSPI_EnterCritical();
+
+    for (uint32_t index = 0; index < pool.Count; index++)
+    {
+        if (POOL_TEST(pool.Erased, index))
+        {
+            POOL_CLEAR(pool.Erased, index);
+            POOL_SET(pool.InUse, index);
+            pool.Stats.Erased--;
+            pool.Stats.InUse++;
+            pool.Stats.Claims++;
+            erased = pool.Stats.Erased;
+            Cypress_QSPI_ExitCritical(primask);
+
+            *address = pool.Start + (index * CYPRESS_SECTOR_SIZE);
+
+            if ((erased < pool.LowWatermark) && (pool.Callback != NULL))
+            {
+                pool.Callback(erased);
+            }
+
+            return HAL_OK;
+        }
+    }
+
+    pool.Stats.Misses++;
+    Cypress_QSPI_ExitCritical(primask);
+
+    return HAL_ERROR;
+}
+
+/**
+* @brief   Gives a claimed sector back to the pool to be erased again
+* @param   address: address within the sector
+* @return  HAL status, HAL_ERROR if the sector is not a claimed pool sector
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_PoolRelease(uint32_t address)
+{
+    uint32_t index;
+    uint32_t primask;
+
+    if ((address < pool.Start) || (address >= (pool.Start + (pool.Count * CYPRESS_SECTOR_SIZE))))
+    {
+        return HAL_ERROR;
+    }
+
+    index = (address - pool.Start) / CYPRESS_SECTOR_SIZE;
+
+    primask = Cypress_QSPI_EnterCritical();
+
+    if (!POOL_TEST(pool.InUse, index))
+    {
+        Cypress_QSPI_ExitCritical(primask);
+        return HAL_ERROR;
+    }
+
+    POOL_CLEAR(pool.InUse, index);
+    pool.Stats.InUse--;
+    pool.Stats.Dirty++;
+    Cypress_QSPI_ExitCritical(primask);
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Gets the state of the pre-erase pool
+* @param   stats: Location to store the sector counts and claim counters
+*/
+
+void Cypress_QSPI_GetPoolStats(Cypress_QSPI_PoolStats *stats)
+{
+    uint32_t primask = Cypress_QSPI_EnterCritical();
+
+    *stats = pool.Stats;
+    Cypress_QSPI_ExitCritical(primask);
+}
+#endif
+
+/**
+* @brief   Reads data into memory in SPI mode (blocking)
+* @param   hqspi: QSPI handle
+* @param   address: starting address to read
+* @param   dest: pointer to memory destination
+* @param   count: bytes to read
+* @return  HAL status
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_Read(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+{
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_READ, address, count) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (HAL_QSPI_Receive(hqspi, dest, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    WRITE_COMBINE_OVERLAY(address, dest, count);
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Writes out pending combined writes before an interrupt or DMA read
+* @param   hqspi: QSPI handle
+* @return  HAL status
+* @note    The peripheral writes the destination directly, so pending combined writes cannot be overlaid
+*          on the result the way the blocking reads do
+* @warning Blocking; only call from thread context. Reads chained from the QSPI callbacks rely on the flush done
+*          when their stream or vector was started, see \ref Cypress_QSPI_ChainReadQuad.
+*/
+
+static HAL_StatusTypeDef Cypress_QSPI_FlushBeforeAsync(QSPI_HandleTypeDef *hqspi)
+{
+    return WRITE_COMBINE_FLUSH(hqspi);
+}
+
+/**
+* @brief   Reads data into memory in SPI mode (non-blocking, requires callbacks)
+* @param   hqspi: QSPI handle
+* @param   address: starting address to read
+* @param   dest: pointer to memory destination
+* @param   count: bytes to read
+* @return  HAL status
+* @remark  Calls HAL_QSPI_RxCpltCallback on completion via interrupt
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_Read_IT(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+{
+    if (Cypress_QSPI_FlushBeforeAsync(hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_READ, address, count) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    // Will call HAL_QSPI_RxCpltCallback on completion
+    if (HAL_QSPI_Receive_IT(hqspi, dest) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Reads data directly into memory in SPI mode (non-blocking, requires callbacks)
+* @param   hqspi: QSPI handle
+* @param   address: starting address to read
+* @param   dest: pointer to memory destination
+* @param   count: bytes to read
+* @return  HAL status
+* @remark  Calls HAL_QSPI_RxCpltCallback on completion via interrupt
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_Read_DMA(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+{
+    if (Cypress_QSPI_FlushBeforeAsync(hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_READ, address, count) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    // Will call HAL_QSPI_RxCpltCallback on completion
+    if (HAL_QSPI_Receive_DMA(hqspi, dest) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Reads data into memory using QSPI (blocking)
+* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
+* @pre     The latency codes must be set appropriately, \ref QSPI_DUMMY
+* @param   hqspi: QSPI handle
+* @param   address: starting address to read
+* @param   dest: pointer to memory destination
+* @param   count: bytes to read
+* @return  HAL status
+* @note    this took me like 3 days to make work: it sends a mode byte as an alternate byte that is super-duper required
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ReadQuad(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+{
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_READ_QUAD_IO, address, count) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (HAL_QSPI_Receive(hqspi, dest, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    WRITE_COMBINE_OVERLAY(address, dest, count);
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Reads data into memory using QSPI (blocking)
+* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
+* @pre     The latency codes must be set appropriately, \ref QSPI_DUMMY
+* @param   hqspi: QSPI handle
+* @param   address: starting address to read
+* @param   dest: pointer to memory destination
+* @param   count: bytes to read
+* @return  HAL status
+* @note    This is an alternate version of ReadQuad that only uses one line for the address and no mode bits
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ReadQuadAlt(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+{
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_READ_QUAD, address, count) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (HAL_QSPI_Receive(hqspi, dest, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    WRITE_COMBINE_OVERLAY(address, dest, count);
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Reads data into memory using QSPI (nonblocking, requires callbacks)
+* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
+* @param   hqspi: QSPI handle
+* @param   address: starting address to read
+* @param   dest: pointer to memory destination
+* @param   count: bytes to read
+* @return  HAL status
+* @remark  Calls HAL_QSPI_RxCpltCallback on completion via interrupt
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ReadQuad_IT(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+{
+    if (Cypress_QSPI_FlushBeforeAsync(hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_READ_QUAD_IO, address, count) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    // This will call HAL_QSPI_RxCpltCallback when complete
+    if (HAL_QSPI_Receive_IT(hqspi, dest) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Reads data directly into memory using QSPI (nonblocking, requires callbacks)
+* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
+* @param   hqspi: QSPI handle
+* @param   address: starting address to read
+* @param   dest: pointer to memory destination
+* @param   count: bytes to read
+* @return  HAL status
+* @remark  Calls HAL_QSPI_RxCpltCallback on completion via interrupt
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ReadQuad_DMA(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+{
+    if (Cypress_QSPI_FlushBeforeAsync(hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_READ_QUAD_IO, address, count) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    // This will call HAL_QSPI_RxCpltCallback when complete
+    if (HAL_QSPI_Receive_DMA(hqspi, dest) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Reads data into memory using dual output (blocking)
+* @pre     The latency codes must be set appropriately, \ref QSPI_DUMMY
+* @param   hqspi: QSPI handle
+* @param   address: starting address to read
+* @param   dest: pointer to memory destination
+* @param   count: bytes to read
+* @return  HAL status
+* @note    Only IO0 and IO1 are used, so IO2/IO3 can stay as WP# and HOLD#
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ReadDual(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+{
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_READ_DUAL, address, count) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (HAL_QSPI_Receive(hqspi, dest, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    WRITE_COMBINE_OVERLAY(address, dest, count);
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Reads data into memory using dual output (nonblocking, requires callbacks)
+* @param   hqspi: QSPI handle
+* @param   address: starting address to read
+* @param   dest: pointer to memory destination
+* @param   count: bytes to read
+* @return  HAL status
+* @note    Only IO0 and IO1 are used, so IO2/IO3 can stay as WP# and HOLD#
+* @remark  Calls HAL_QSPI_RxCpltCallback on completion via interrupt
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ReadDual_IT(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+{
+    if (Cypress_QSPI_FlushBeforeAsync(hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_READ_DUAL, address, count) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    // This will call HAL_QSPI_RxCpltCallback when complete
+    if (HAL_QSPI_Receive_IT(hqspi, dest) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Reads data directly into memory using dual output (nonblocking, requires callbacks)
+* @param   hqspi: QSPI handle
+* @param   address: starting address to read
+* @param   dest: pointer to memory destination
+* @param   count: bytes to read
+* @return  HAL status
+* @note    Only IO0 and IO1 are used, so IO2/IO3 can stay as WP# and HOLD#
+* @remark  Calls HAL_QSPI_RxCpltCallback on completion via interrupt
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ReadDual_DMA(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+{
+    if (Cypress_QSPI_FlushBeforeAsync(hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_READ_DUAL, address, count) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    // This will call HAL_QSPI_RxCpltCallback when complete
+    if (HAL_QSPI_Receive_DMA(hqspi, dest) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Reads data into memory using dual I/O (blocking)
+* @pre     The latency codes must be set appropriately, \ref QSPI_DUMMY
+* @param   hqspi: QSPI handle
+* @param   address: starting address to read
+* @param   dest: pointer to memory destination
+* @param   count: bytes to read
+* @return  HAL status
+* @note    Only IO0 and IO1 are used, so IO2/IO3 can stay as WP# and HOLD#
+* @note    The DUALIO latency includes the 4 mode clocks, which are sent as the alternate byte
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ReadDualIO(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+{
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_READ_DUAL_IO, address, count) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (HAL_QSPI_Receive(hqspi, dest, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    WRITE_COMBINE_OVERLAY(address, dest, count);
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Reads data into memory using dual I/O (nonblocking, requires callbacks)
+* @param   hqspi: QSPI handle
+* @param   address: starting address to read
+* @param   dest: pointer to memory destination
+* @param   count: bytes to read
+* @return  HAL status
+* @note    Only IO0 and IO1 are used, so IO2/IO3 can stay as WP# and HOLD#
+* @note    The DUALIO latency includes the 4 mode clocks, which are sent as the alternate byte
+* @remark  Calls HAL_QSPI_RxCpltCallback on completion via interrupt
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ReadDualIO_IT(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+{
+    if (Cypress_QSPI_FlushBeforeAsync(hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_READ_DUAL_IO, address, count) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    // This will call HAL_QSPI_RxCpltCallback when complete
+    if (HAL_QSPI_Receive_IT(hqspi, dest) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Reads data directly into memory using dual I/O (nonblocking, requires callbacks)
+* @param   hqspi: QSPI handle
+* @param   address: starting address to read
+* @param   dest: pointer to memory destination
+* @param   count: bytes to read
+* @return  HAL status
+* @note    Only IO0 and IO1 are used, so IO2/IO3 can stay as WP# and HOLD#
+* @note    The DUALIO latency includes the 4 mode clocks, which are sent as the alternate byte
+* @remark  Calls HAL_QSPI_RxCpltCallback on completion via interrupt
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ReadDualIO_DMA(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+{
+    if (Cypress_QSPI_FlushBeforeAsync(hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_READ_DUAL_IO, address, count) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    // This will call HAL_QSPI_RxCpltCallback when complete
+    if (HAL_QSPI_Receive_DMA(hqspi, dest) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Reads data into memory in DDR SPI mode (blocking)
+* @pre     The latency codes must be set appropriately, \ref QSPI_DUMMY
+* @pre     Init.SampleShifting must be QSPI_SAMPLE_SHIFTING_NONE for DDR commands
+* @param   hqspi: QSPI handle
+* @param   address: starting address to read
+* @param   dest: pointer to memory destination
+* @param   count: bytes to read
+* @return  HAL status
+* @note    The mode byte takes 4 clocks on one line in DDR
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ReadDDR(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+{
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_READ_DDR, address, count) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (HAL_QSPI_Receive(hqspi, dest, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    WRITE_COMBINE_OVERLAY(address, dest, count);
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Reads data into memory in DDR SPI mode (non-blocking, requires callbacks)
+* @pre     The latency codes must be set appropriately, \ref QSPI_DUMMY
+* @pre     Init.SampleShifting must be QSPI_SAMPLE_SHIFTING_NONE for DDR commands
+* @param   hqspi: QSPI handle
+* @param   address: starting address to read
+* @param   dest: pointer to memory destination
+* @param   count: bytes to read
+* @return  HAL status
+* @remark  Calls HAL_QSPI_RxCpltCallback on completion via interrupt
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ReadDDR_IT(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+{
+    if (Cypress_QSPI_FlushBeforeAsync(hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_READ_DDR, address, count) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    // This will call HAL_QSPI_RxCpltCallback when complete
+    if (HAL_QSPI_Receive_IT(hqspi, dest) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Reads data directly into memory in DDR SPI mode (non-blocking, requires callbacks)
+* @pre     The latency codes must be set appropriately, \ref QSPI_DUMMY
+* @pre     Init.SampleShifting must be QSPI_SAMPLE_SHIFTING_NONE for DDR commands
+* @param   hqspi: QSPI handle
+* @param   address: starting address to read
+* @param   dest: pointer to memory destination
+* @param   count: bytes to read
+* @return  HAL status
+* @remark  Calls HAL_QSPI_RxCpltCallback on completion via interrupt
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ReadDDR_DMA(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+{
+    if (Cypress_QSPI_FlushBeforeAsync(hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_READ_DDR, address, count) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    // This will call HAL_QSPI_RxCpltCallback when complete
+    if (HAL_QSPI_Receive_DMA(hqspi, dest) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Reads data into memory using DDR QSPI (blocking)
+* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
+* @pre     The latency codes must be set appropriately, \ref QSPI_DUMMY
+* @pre     Init.SampleShifting must be QSPI_SAMPLE_SHIFTING_NONE for DDR commands
+* @param   hqspi: QSPI handle
+* @param   address: starting address to read
+* @param   dest: pointer to memory destination
+* @param   count: bytes to read
+* @return  HAL status
+* @note    Transfers a byte every clock, twice the throughput of \ref Cypress_QSPI_ReadQuad at the same SCK
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ReadQuadDDR(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+{
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_READ_QUAD_IO_DDR, address, count) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (HAL_QSPI_Receive(hqspi, dest, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    WRITE_COMBINE_OVERLAY(address, dest, count);
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Reads data into memory using DDR QSPI (non-blocking, requires callbacks)
+* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
+* @pre     The latency codes must be set appropriately, \ref QSPI_DUMMY
+* @pre     Init.SampleShifting must be QSPI_SAMPLE_SHIFTING_NONE for DDR commands
+* @param   hqspi: QSPI handle
+* @param   address: starting address to read
+* @param   dest: pointer to memory destination
+* @param   count: bytes to read
+* @return  HAL status
+* @remark  Calls HAL_QSPI_RxCpltCallback on completion via interrupt
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ReadQuadDDR_IT(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+{
+    if (Cypress_QSPI_FlushBeforeAsync(hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_READ_QUAD_IO_DDR, address, count) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    // This will call HAL_QSPI_RxCpltCallback when complete
+    if (HAL_QSPI_Receive_IT(hqspi, dest) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Reads data directly into memory using DDR QSPI (non-blocking, requires callbacks)
+* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
+* @pre     The latency codes must be set appropriately, \ref QSPI_DUMMY
+* @pre     Init.SampleShifting must be QSPI_SAMPLE_SHIFTING_NONE for DDR commands
+* @param   hqspi: QSPI handle
+* @param   address: starting address to read
+* @param   dest: pointer to memory destination
+* @param   count: bytes to read
+* @return  HAL status
+* @remark  Calls HAL_QSPI_RxCpltCallback on completion via interrupt
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ReadQuadDDR_DMA(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+{
+    if (Cypress_QSPI_FlushBeforeAsync(hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_READ_QUAD_IO_DDR, address, count) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    // This will call HAL_QSPI_RxCpltCallback when complete
+    if (HAL_QSPI_Receive_DMA(hqspi, dest) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Maps the flash into the MCU address space using Quad I/O reads
+* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
+* @pre     The latency codes must be set appropriately, \ref QSPI_DUMMY
+* @param   hqspi: QSPI handle
+* @return  HAL status
+* @note    Once enabled, the flash can be read through plain pointers starting at \ref CYPRESS_MEMORY_MAPPED_ADDR
+* @note    No other command can be issued until \ref Cypress_QSPI_DisableMemoryMapped is called
+* @note    The mode byte is sent as 0x00 so the flash never enters continuous read mode
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_EnableMemoryMapped(QSPI_HandleTypeDef *hqspi)
+{
+    QSPI_CommandTypeDef      sCommand;
+    QSPI_MemoryMappedTypeDef sMemMappedCfg;
+
+    // Memory-mapped reads bypass the driver, so write out pending combined writes first
+    if (WRITE_COMBINE_FLUSH(hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    Cypress_QSPI_BuildCommand(CMD_READ_QUAD_IO, 0, 0, &sCommand);
+
+    // Keep nCS low between accesses, the peripheral handles prefetching
+    sMemMappedCfg.TimeOutActivation = QSPI_TIMEOUT_COUNTER_DISABLE;
+    sMemMappedCfg.TimeOutPeriod     = 0;
+
+    if (HAL_QSPI_MemoryMapped(hqspi, &sCommand, &sMemMappedCfg) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Leaves memory-mapped mode so that indirect commands can be issued again
+* @param   hqspi: QSPI handle
+* @return  HAL status
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_DisableMemoryMapped(QSPI_HandleTypeDef *hqspi)
+{
+    // Aborting is the only way to exit memory-mapped mode
+    if (HAL_QSPI_Abort(hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Starts a continuous read session
+* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
+* @param   hqspi: QSPI handle
+* @return  HAL status, HAL_ERROR if a session is already open or the peripheral is busy
+* @note    Nothing is sent to the flash until the first \ref Cypress_QSPI_ReadContinuous
+* @warning No other command may be issued until \ref Cypress_QSPI_EndContinuousRead is called,
+*          since the flash will interpret it as the address of the next read
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_BeginContinuousRead(QSPI_HandleTypeDef *hqspi)
+{
+    if ((continuousReadState != 0) || (HAL_QSPI_GetState(hqspi) != HAL_QSPI_STATE_READY))
+    {
+        return HAL_ERROR;
+    }
+
+    continuousReadState = 1;
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Reads data into memory using QSPI within a continuous read session (blocking)
+* @pre     A session must have been started by \ref Cypress_QSPI_BeginContinuousRead
+* @param   hqspi: QSPI handle
+* @param   address: starting address to read
+* @param   dest: pointer to memory destination
+* @param   count: bytes to read, at least 1
+* @return  HAL status
+* @note    The first read of a session sends the instruction, every following read starts directly with the address,
+*          saving the 8 single-line instruction clocks
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ReadContinuous(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+{
+    if ((continuousReadState == 0) || (count == 0))
+    {
+        return HAL_ERROR;
+    }
+
+    QSPI_CommandTypeDef sCommand;
+
+    Cypress_QSPI_BuildCommand(CMD_READ_QUAD_IO, address, count, &sCommand);
+    sCommand.AlternateBytes     = CYPRESS_CONTINUOUS_READ_MODE;
+    sCommand.InstructionMode    = (continuousReadState == 2) ? QSPI_INSTRUCTION_NONE : QSPI_INSTRUCTION_1_LINE;
+
+    if  (HAL_QSPI_Command(hqspi, &sCommand, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    // The mode bits have been sent, so the flash now expects the next address directly
+    continuousReadState = 2;
+
+    if (HAL_QSPI_Receive(hqspi, dest, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    WRITE_COMBINE_OVERLAY(address, dest, count);
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Ends a continuous read session, returning the flash to normal command mode
+* @param   hqspi: QSPI handle
+* @return  HAL status
+* @note    If this fails, \ref Cypress_QSPI_ModeBitReset will also force the flash out of continuous read mode
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_EndContinuousRead(QSPI_HandleTypeDef *hqspi)
+{
+    if (continuousReadState != 2)
+    {
+        // The flash never left normal mode
+        continuousReadState = 0;
+        return HAL_OK;
+    }
+
+    QSPI_CommandTypeDef sCommand;
+    uint8_t discard;
+
+    // Address-only read with mode bits that are not 0xAx, so the flash exits continuous mode afterwards
+    Cypress_QSPI_BuildCommand(CMD_READ_QUAD_IO, 0, 1, &sCommand);
+    sCommand.InstructionMode    = QSPI_INSTRUCTION_NONE;
+
+    if  (HAL_QSPI_Command(hqspi, &sCommand, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    continuousReadState = 0;
+
+    if (HAL_QSPI_Receive(hqspi, &discard, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+#if (USE_HAL_QSPI_REGISTER_CALLBACKS == 1)
+/**
+* @brief   Starts a quad read for a stream or vectored read, without flushing combined writes (nonblocking)
+* @param   hqspi: QSPI handle
+* @param   address: starting address to read
+* @param   dest: pointer to memory destination
+* @param   count: bytes to read
+* @param   dma: 1 to receive by DMA, 0 by interrupt
+* @return  HAL status
+* @note    Safe to call from the QSPI callbacks. The write-combining buffer is flushed once when the stream or vector
+*          starts, and \ref Cypress_QSPI_ProgramCombined is refused while either is running.
+*/
+
+static HAL_StatusTypeDef Cypress_QSPI_ChainReadQuad(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count, uint8_t dma)
+{
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_READ_QUAD_IO, address, count) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    // This will call HAL_QSPI_RxCpltCallback when complete
+    return dma ? HAL_QSPI_Receive_DMA(hqspi, dest) : HAL_QSPI_Receive_IT(hqspi, dest);
+}
+
+/**
+* @brief   Ends a stream and gives the QSPI callbacks back to the application
+* @param   hqspi: QSPI handle
+* @param   status: final stream status
+*/
+
+static void Cypress_QSPI_StreamFinish(QSPI_HandleTypeDef *hqspi, HAL_StatusTypeDef status)
+{
+    HAL_QSPI_RegisterCallback(hqspi, HAL_QSPI_RX_CPLT_CB_ID, stream.SavedRxCplt);
+    HAL_QSPI_RegisterCallback(hqspi, HAL_QSPI_ERROR_CB_ID, stream.SavedError);
+    stream.Status = status;
+}
+
+/**
+* @brief   RxCplt callback while a stream is running
+* @param   hqspi: QSPI handle
+* @note    The next chunk is started into the other buffer before the finished one is handed to the consumer,
+*          so the bus stays busy. The finished buffer is only reused once that next chunk completes.
+*/
+
+static void Cypress_QSPI_StreamRxCplt(QSPI_HandleTypeDef *hqspi)
+{
+    uint8_t *chunk = stream.Buffer[stream.Active];
+    uint32_t chunkAddress = stream.Address;
+    uint32_t chunkCount = stream.Pending;
+    HAL_StatusTypeDef status = HAL_OK;
+
+#if defined(__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
+    SCB_InvalidateDCache_by_Addr((void *)chunk, (int32_t)chunkCount);
+#endif
+
+    stream.Address += chunkCount;
+    stream.Remaining -= chunkCount;
+
+    if (stream.Remaining != 0)
+    {
+        stream.Active ^= 1;
+        stream.Pending = (stream.Remaining < stream.ChunkSize) ? stream.Remaining : stream.ChunkSize;
+        status = Cypress_QSPI_ChainReadQuad(hqspi, stream.Address, stream.Buffer[stream.Active], stream.Pending, 1);
+    }
+
+    // Hand the chunk over before the stream is marked done, so a poller never sees completion ahead of the data
+    stream.Callback(chunk, chunkAddress, chunkCount);
+
+    if (stream.Remaining == 0)
+    {
+        Cypress_QSPI_StreamFinish(hqspi, HAL_OK);
+    }
+    else if (status != HAL_OK)
+    {
+        Cypress_QSPI_StreamFinish(hqspi, HAL_ERROR);
+    }
+}
+
+/**
+* @brief   Error callback while a stream is running
+* @param   hqspi: QSPI handle
+* @remark  The application's error callback is still called
+*/
+
+static void Cypress_QSPI_StreamError(QSPI_HandleTypeDef *hqspi)
+{
+    Cypress_QSPI_StreamFinish(hqspi, HAL_ERROR);
+    stream.SavedError(hqspi);
+}
+
+/**
+* @brief   Streams a region through two buffers using quad DMA reads (nonblocking)
+* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
+* @pre     Register callbacks must be enabled for QUADSPI
+* @param   hqspi: QSPI handle
+* @param   address: starting address to read
+* @param   count: total bytes to read
+* @param   buffer0: first chunk buffer, at least chunkSize bytes
+* @param   buffer1: second chunk buffer, at least chunkSize bytes
+* @param   chunkSize: bytes per chunk
+* @param   callback: called from the QSPI interrupt with each finished chunk
+* @return  HAL status
+* @note    The buffers are used in turn. The callback must be done with a chunk before it returns, as the following
+*          chunk is already in flight and the buffer is reused right after it.
+* @note    With the D-cache enabled, buffers must be 32-byte aligned and chunkSize a multiple of 32
+* @remark  The RxCplt and Error callbacks are borrowed for the duration of the stream, see \ref Cypress_QSPI_GetStreamStatus
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ReadStream(QSPI_HandleTypeDef *hqspi, uint32_t address, uint32_t count, uint8_t *buffer0, uint8_t *buffer1, uint32_t chunkSize, Cypress_QSPI_ChunkCallback callback)
+{
+    if (stream.Status == HAL_BUSY)
+    {
+        return HAL_BUSY;
+    }
+
+    if ((count == 0) || (chunkSize == 0) || (buffer0 == NULL) || (buffer1 == NULL) || (callback == NULL))
+    {
+        return HAL_ERROR;
+    }
+
+    // Once for the whole stream, the later chunks are started from the interrupt
+    if (Cypress_QSPI_FlushBeforeAsync(hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    stream.Callback = callback;
+    stream.SavedRxCplt = hqspi->RxCpltCallback;
+    stream.SavedError = hqspi->ErrorCallback;
+    stream.Buffer[0] = buffer0;
+    stream.Buffer[1] = buffer1;
+    stream.Address = address;
+    stream.Remaining = count;
+    stream.ChunkSize = chunkSize;
+    stream.Pending = (count < chunkSize) ? count : chunkSize;
+    stream.Active = 0;
+
+    if (HAL_QSPI_RegisterCallback(hqspi, HAL_QSPI_RX_CPLT_CB_ID, Cypress_QSPI_StreamRxCplt) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (HAL_QSPI_RegisterCallback(hqspi, HAL_QSPI_ERROR_CB_ID, Cypress_QSPI_StreamError) != HAL_OK)
+    {
+        HAL_QSPI_RegisterCallback(hqspi, HAL_QSPI_RX_CPLT_CB_ID, stream.SavedRxCplt);
+        return HAL_ERROR;
+    }
+
+    stream.Status = HAL_BUSY;
+
+    if (Cypress_QSPI_ChainReadQuad(hqspi, stream.Address, stream.Buffer[0], stream.Pending, 1) != HAL_OK)
+    {
+        Cypress_QSPI_StreamFinish(hqspi, HAL_ERROR);
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Gets the state of the last stream
+* @return  HAL_BUSY while running, HAL_OK once every chunk was delivered, HAL_ERROR if it failed or was aborted
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_GetStreamStatus(void)
+{
+    return stream.Status;
+}
+
+/**
+* @brief   Stops a running stream
+* @param   hqspi: QSPI handle
+* @return  HAL status
+* @note    Chunks that were not delivered yet are dropped
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_AbortStream(QSPI_HandleTypeDef *hqspi)
+{
+    if (stream.Status != HAL_BUSY)
+    {
+        return HAL_OK;
+    }
+
+    // Callbacks can only be registered again once the peripheral is idle
+    if (HAL_QSPI_Abort(hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    // The last chunk may have completed before the abort
+    if (stream.Status == HAL_BUSY)
+    {
+        Cypress_QSPI_StreamFinish(hqspi, HAL_ERROR);
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Ends a vectored read and gives the QSPI callbacks back to the application
+* @param   hqspi: QSPI handle
+* @param   status: final status passed to the completion callback
+*/
+
+static void Cypress_QSPI_ReadVFinish(QSPI_HandleTypeDef *hqspi, HAL_StatusTypeDef status)
+{
+    HAL_QSPI_RegisterCallback(hqspi, HAL_QSPI_RX_CPLT_CB_ID, readV.SavedRxCplt);
+    HAL_QSPI_RegisterCallback(hqspi, HAL_QSPI_ERROR_CB_ID, readV.SavedError);
+    readV.Status = status;
+
+    if (readV.Callback != NULL)
+    {
+        readV.Callback(status);
+    }
+}
+
+/**
+* @brief   RxCplt callback while a vectored read is running, starts the next descriptor
+* @param   hqspi: QSPI handle
+*/
+
+static void Cypress_QSPI_ReadVRxCplt(QSPI_HandleTypeDef *hqspi)
+{
+    const Cypress_QSPI_ReadDescriptor *next;
+
+    // Skip empty descriptors, the HAL cannot issue a zero-length read
+    do
+    {
+        readV.Index++;
+        next = &readV.Vector[readV.Index];
+    } while ((readV.Index < readV.Length) && (next->Count == 0));
+
+    if (readV.Index == readV.Length)
+    {
+        Cypress_QSPI_ReadVFinish(hqspi, HAL_OK);
+        return;
+    }
+
+    if (Cypress_QSPI_ChainReadQuad(hqspi, next->Address, next->Dest, next->Count, 0) != HAL_OK)
+    {
+        Cypress_QSPI_ReadVFinish(hqspi, HAL_ERROR);
+    }
+}
+
+/**
+* @brief   Error callback while a vectored read is running
+* @param   hqspi: QSPI handle
+* @remark  The application's error callback is still called
+*/
+
+static void Cypress_QSPI_ReadVError(QSPI_HandleTypeDef *hqspi)
+{
+    Cypress_QSPI_ReadVFinish(hqspi, HAL_ERROR);
+    readV.SavedError(hqspi);
+}
+
+/**
+* @brief   Reads a list of regions using quad reads chained from the interrupt (nonblocking)
+* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
+* @pre     Register callbacks must be enabled for QUADSPI
+* @param   hqspi: QSPI handle
+* @param   vector: descriptors to read, in order; must stay valid until completion
+* @param   length: number of descriptors
+* @param   callback: called once from the QSPI interrupt when the whole vector is done, may be NULL
+* @return  HAL status
+* @note    Without a callback, poll \ref Cypress_QSPI_GetReadVStatus
+* @remark  The RxCplt and Error callbacks are borrowed until the vector is done
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ReadV(QSPI_HandleTypeDef *hqspi, const Cypress_QSPI_ReadDescriptor *vector, uint32_t length, Cypress_QSPI_CompleteCallback callback)
+{
+    uint32_t first = 0;
+
+    if (readV.Status == HAL_BUSY)
+    {
+        return HAL_BUSY;
+    }
+
+    if (vector == NULL)
+    {
+        return HAL_ERROR;
+    }
+
+    while ((first < length) && (vector[first].Count == 0))
+    {
+        first++;
+    }
+
+    readV.Vector = vector;
+    readV.Length = length;
+    readV.Index = first;
+    readV.Callback = callback;
+    readV.SavedRxCplt = hqspi->RxCpltCallback;
+    readV.SavedError = hqspi->ErrorCallback;
+
+    if (first == length)
+    {
+        // Nothing to read
+        readV.Status = HAL_OK;
+
+        if (callback != NULL)
+        {
+            callback(HAL_OK);
+        }
+
+        return HAL_OK;
+    }
+
+    // Once for the whole vector, the later descriptors are started from the interrupt
+    if (Cypress_QSPI_FlushBeforeAsync(hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (HAL_QSPI_RegisterCallback(hqspi, HAL_QSPI_RX_CPLT_CB_ID, Cypress_QSPI_ReadVRxCplt) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (HAL_QSPI_RegisterCallback(hqspi, HAL_QSPI_ERROR_CB_ID, Cypress_QSPI_ReadVError) != HAL_OK)
+    {
+        HAL_QSPI_RegisterCallback(hqspi, HAL_QSPI_RX_CPLT_CB_ID, readV.SavedRxCplt);
+        return HAL_ERROR;
+    }
+
+    readV.Status = HAL_BUSY;
+
+    if (Cypress_QSPI_ChainReadQuad(hqspi, vector[first].Address, vector[first].Dest, vector[first].Count, 0) != HAL_OK)
+    {
+        // Nothing was started, so the callback is not called
+        readV.Callback = NULL;
+        Cypress_QSPI_ReadVFinish(hqspi, HAL_ERROR);
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Gets the state of the last vectored read
+* @return  HAL_BUSY while running, HAL_OK once every descriptor was read, HAL_ERROR if it failed
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_GetReadVStatus(void)
+{
+    return readV.Status;
+}
+#endif
+
+#if (CYPRESS_CACHE_LINES > 0)
+/**
+* @brief   Finds the cache line holding a flash line
+* @param   lineAddress: flash address, aligned to CYPRESS_CACHE_LINE_SIZE
+* @return  line index, or -1 on a miss
+*/
+
+static int32_t Cypress_QSPI_CacheLookup(uint32_t lineAddress)
+{
+    uint32_t set = (lineAddress / CYPRESS_CACHE_LINE_SIZE) % (CYPRESS_CACHE_LINES / CYPRESS_CACHE_WAYS);
+
+    for (uint32_t way = 0; way < CYPRESS_CACHE_WAYS; way++)
+    {
+        uint32_t line = set * CYPRESS_CACHE_WAYS + way;
+
+        if ((cache.LastUse[line] != 0) && (cache.Tag[line] == lineAddress))
+        {
+            return (int32_t)line;
+        }
+    }
+
+    return -1;
+}
+
+/**
+* @brief   Picks the line to replace for a flash line, preferring invalid lines over the least recently used one
+* @param   lineAddress: flash address, aligned to CYPRESS_CACHE_LINE_SIZE
+* @return  line index
+*/
+
+static uint32_t Cypress_QSPI_CacheVictim(uint32_t lineAddress)
+{
+    uint32_t set = (lineAddress / CYPRESS_CACHE_LINE_SIZE) % (CYPRESS_CACHE_LINES / CYPRESS_CACHE_WAYS);
+    uint32_t victim = set * CYPRESS_CACHE_WAYS;
+
+    for (uint32_t way = 1; way < CYPRESS_CACHE_WAYS; way++)
+    {
+        uint32_t line = set * CYPRESS_CACHE_WAYS + way;
+
+        if (cache.LastUse[line] < cache.LastUse[victim])
+        {
+            victim = line;
+        }
+    }
+
+    return victim;
+}
+
+/**
+* @brief   Marks a line as most recently used
+* @param   line: line index
+*/
+
+static void Cypress_QSPI_CacheTouch(uint32_t line)
+{
+    cache.Clock++;
+
+    // On wrap, restart the stamps so the LRU order stays usable
+    if (cache.Clock == 0)
+    {
+        for (uint32_t i = 0; i < CYPRESS_CACHE_LINES; i++)
+        {
+            if (cache.LastUse[i] != 0)
+            {
+                cache.LastUse[i] = 1;
+            }
+        }
+
+        cache.Clock = 2;
+    }
+
+    cache.LastUse[line] = cache.Clock;
+}
+
+/**
+* @brief   Reads data into memory through the read cache using QSPI (blocking)
+* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
+* @param   hqspi: QSPI handle
+* @param   address: starting address to read
+* @param   dest: pointer to memory destination
+* @param   count: bytes to read
+* @return  HAL status
+* @note    Misses read a whole line with \ref Cypress_QSPI_ReadQuad, so lines must not cross the end of the flash
+* @note    Reads issued while a program or erase is in progress can cache busy data; wait for completion first
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ReadQuadCached(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+{
+    while (count > 0)
+    {
+        uint32_t lineAddress = address & ~(uint32_t)(CYPRESS_CACHE_LINE_SIZE - 1);
+        uint32_t offset = address - lineAddress;
+        uint32_t chunk = CYPRESS_CACHE_LINE_SIZE - offset;
+        int32_t found = Cypress_QSPI_CacheLookup(lineAddress);
+        uint32_t line;
+
+        if (chunk > count)
+        {
+            chunk = count;
+        }
+
+        if (found >= 0)
+        {
+            line = (uint32_t)found;
+            cache.Stats.Hits++;
+        }
+        else
+        {
+            line = Cypress_QSPI_CacheVictim(lineAddress);
+            cache.Stats.Misses++;
+
+            if (cache.LastUse[line] != 0)
+            {
+                cache.Stats.Evictions++;
+            }
+
+            // Invalid until the fill succeeds
+            cache.LastUse[line] = 0;
+
+            if (Cypress_QSPI_ReadQuad(hqspi, lineAddress, cache.Data[line], CYPRESS_CACHE_LINE_SIZE) != HAL_OK)
+            {
+                return HAL_ERROR;
+            }
+
+            cache.Tag[line] = lineAddress;
+        }
+
+        Cypress_QSPI_CacheTouch(line);
+
+        for (uint32_t i = 0; i < chunk; i++)
+        {
+            dest[i] = cache.Data[line][offset + i];
+        }
+
+        address += chunk;
+        dest += chunk;
+        count -= chunk;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Reads data directly into memory, served from the read cache when possible (nonblocking, requires callbacks)
+* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
+* @param   hqspi: QSPI handle
+* @param   address: starting address to read
+* @param   dest: pointer to memory destination
+* @param   count: bytes to read
+* @return  HAL status
+* @note    Otherwise the whole range is read with \ref Cypress_QSPI_ReadQuad_DMA and is not added to the cache,
+*          as the DMA writes dest without the driver seeing the data. Repeated DMA reads of the same uncached range
+*          therefore keep missing; warm the cache with \ref Cypress_QSPI_ReadQuadCached to make them hit.
+* @note    Such a read counts once in the Uncached counter, and not per line in Hits or Misses
+* @warning When every line is cached, the data is copied and the RxCplt callback is called from this function, in
+*          the caller's context and before it returns, not from the QSPI interrupt. Set up any completion state
+*          the callback relies on before calling.
+* @remark  Calls HAL_QSPI_RxCpltCallback on completion
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ReadQuadCached_DMA(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+{
+    uint32_t first = address & ~(uint32_t)(CYPRESS_CACHE_LINE_SIZE - 1);
+
+    if (count == 0)
+    {
+        return HAL_ERROR;
+    }
+
+    for (uint32_t lineAddress = first; lineAddress < address + count; lineAddress += CYPRESS_CACHE_LINE_SIZE)
+    {
+        if (Cypress_QSPI_CacheLookup(lineAddress) < 0)
+        {
+            // The whole range comes from the flash, whichever lines were cached
+            cache.Stats.Uncached++;
+            return Cypress_QSPI_ReadQuad_DMA(hqspi, address, dest, count);
+        }
+    }
+
+    // Every line is present, so this cannot touch the flash
+    if (Cypress_QSPI_ReadQuadCached(hqspi, address, dest, count) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+#if (USE_HAL_QSPI_REGISTER_CALLBACKS == 1)
+    hqspi->RxCpltCallback(hqspi);
+#else
+    HAL_QSPI_RxCpltCallback(hqspi);
+#endif
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Drops every cached line overlapping a flash range
+* @param   address: starting address of the range
+* @param   count: bytes in the range
+*/
+
+void Cypress_QSPI_CacheInvalidate(uint32_t address, uint32_t count)
+{
+    uint32_t end = address + count;
+
+    for (uint32_t line = 0; line < CYPRESS_CACHE_LINES; line++)
+    {
+        if ((cache.LastUse[line] != 0) && (cache.Tag[line] < end) && ((cache.Tag[line] + CYPRESS_CACHE_LINE_SIZE) > address))
+        {
+            cache.LastUse[line] = 0;
+        }
+    }
+}
+
+/**
+* @brief   Drops every cached line
+*/
+
+void Cypress_QSPI_CacheInvalidateAll(void)
+{
+    for (uint32_t line = 0; line < CYPRESS_CACHE_LINES; line++)
+    {
+        cache.LastUse[line] = 0;
+    }
+}
+
+/**
+* @brief   Gets the read cache counters
+* @param   stats: Location to store the counters
+*/
+
+void Cypress_QSPI_GetCacheStats(Cypress_QSPI_CacheStats *stats)
+{
+    *stats = cache.Stats;
+}
+
+/**
+* @brief   Clears the read cache counters
+*/
+
+void Cypress_QSPI_ResetCacheStats(void)
+{
+    cache.Stats.Hits = 0;
+    cache.Stats.Misses = 0;
+    cache.Stats.Evictions = 0;
+    cache.Stats.Uncached = 0;
+}
+#endif
+
+#if (CYPRESS_PREFETCH_SIZE > 0)
+/**
+* @brief   Gives the QSPI callbacks back to the application after a prefetch
+* @param   hqspi: QSPI handle
+*/
+
+static void Cypress_QSPI_PrefetchRestore(QSPI_HandleTypeDef *hqspi)
+{
+    HAL_QSPI_RegisterCallback(hqspi, HAL_QSPI_RX_CPLT_CB_ID, prefetch.SavedRxCplt);
+    HAL_QSPI_RegisterCallback(hqspi, HAL_QSPI_ERROR_CB_ID, prefetch.SavedError);
+}
+
+/**
+* @brief   RxCplt callback while a prefetch is in flight
+* @param   hqspi: QSPI handle
+*/
+
+static void Cypress_QSPI_PrefetchRxCplt(QSPI_HandleTypeDef *hqspi)
+{
+#if defined(__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
+    SCB_InvalidateDCache_by_Addr((void *)prefetch.Buffer, (int32_t)prefetch.Length);
+#endif
+
+    Cypress_QSPI_PrefetchRestore(hqspi);
+    prefetch.State = 2;
+}
+
+/**
+* @brief   Error callback while a prefetch is in flight, drops the block
+* @param   hqspi: QSPI handle
+* @note    The application is not told, as it never asked for this read
+*/
+
+static void Cypress_QSPI_PrefetchError(QSPI_HandleTypeDef *hqspi)
+{
+    Cypress_QSPI_PrefetchRestore(hqspi);
+    prefetch.State = 0;
+}
+
+/**
+* @brief   Waits for a prefetch in flight to land
+* @param   hqspi: QSPI handle
+* @return  HAL status
+*/
+
+static HAL_StatusTypeDef Cypress_QSPI_PrefetchWait(QSPI_HandleTypeDef *hqspi)
+{
+    uint32_t start = HAL_GetTick();
+
+    while (prefetch.State == 1)
+    {
+        if ((HAL_GetTick() - start) > HAL_QSPI_TIMEOUT_DEFAULT_VALUE)
+        {
+            HAL_QSPI_Abort(hqspi);
+            Cypress_QSPI_PrefetchRestore(hqspi);
+            prefetch.State = 0;
+            return HAL_ERROR;
+        }
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Drops the prefetched block, counting it if it was never used
+*/
+
+static void Cypress_QSPI_PrefetchDrop(void)
+{
+    if ((prefetch.State == 2) && !prefetch.Used)
+    {
+        prefetch.Stats.Wasted++;
+
+        if (prefetch.Stats.Block > CYPRESS_PREFETCH_MIN_BLOCK)
+        {
+            prefetch.Stats.Block /= 2;
+        }
+    }
+
+    prefetch.State = 0;
+}
+
+/**
+* @brief   Reads data into memory using QSPI, reading ahead on sequential access (blocking)
+* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
+* @pre     Register callbacks must be enabled for QUADSPI
+* @param   hqspi: QSPI handle
+* @param   address: starting address to read
+* @param   dest: pointer to memory destination
+* @param   count: bytes to read
+* @return  HAL status
+* @note    Once a call continues where the previous one ended, the next block is read by DMA in the background
+*          so the following call can complete from RAM, see \ref QSPI_PREFETCH
+* @note    Other commands return HAL_BUSY while a prefetch is in flight; call \ref Cypress_QSPI_PrefetchInvalidate first.
+*          The program and erase functions do this themselves.
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ReadQuadPrefetch(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+{
+    uint8_t sequential = (address == prefetch.NextAddress);
+    uint8_t fromBuffer = 0;
+    uint32_t requestAddress = address;
+    uint8_t *requestDest = dest;
+    uint32_t requestCount = count;
+
+    if (count == 0)
+    {
+        return HAL_ERROR;
+    }
+
+    prefetch.Stats.Requests++;
+
+    if (Cypress_QSPI_PrefetchWait(hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if ((prefetch.State == 2) && (address >= prefetch.Address) && (address < (prefetch.Address + prefetch.Length)))
+    {
+        uint32_t offset = address - prefetch.Address;
+        uint32_t available = prefetch.Length - offset;
+        uint32_t chunk = (available < count) ? available : count;
+
+        for (uint32_t i = 0; i < chunk; i++)
+        {
+            dest[i] = prefetch.Buffer[offset + i];
+        }
+
+        prefetch.Used = 1;
+        fromBuffer = 1;
+        address += chunk;
+        dest += chunk;
+        count -= chunk;
+    }
+    else
+    {
+        Cypress_QSPI_PrefetchDrop();
+    }
+
+    if (count == 0)
+    {
+        prefetch.Stats.Hits++;
+    }
+    else
+    {
+        if (fromBuffer)
+        {
+            prefetch.Stats.PartialHits++;
+
+            // The stream outran the prefetch, so read further ahead next time
+            if (prefetch.Stats.Block < CYPRESS_PREFETCH_SIZE)
+            {
+                prefetch.Stats.Block *= 2;
+            }
+        }
+
+        if (Cypress_QSPI_ReadQuad(hqspi, address, dest, count) != HAL_OK)
+        {
+            return HAL_ERROR;
+        }
+    }
+
+    // Covers the data served from the prefetch buffer, the rest was already overlaid
+    WRITE_COMBINE_OVERLAY(requestAddress, requestDest, requestCount);
+
+    prefetch.Sequential = sequential;
+    prefetch.NextAddress = address + count;
+
+    // Nothing left to read ahead at the end of the array
+    if (!prefetch.Sequential || (prefetch.NextAddress >= CYPRESS_FLASH_SIZE))
+    {
+        return HAL_OK;
+    }
+
+    // Keep the current block while it still holds the next request
+    if ((prefetch.State == 2) && ((prefetch.Address + prefetch.Length) > prefetch.NextAddress))
+    {
+        return HAL_OK;
+    }
+
+    prefetch.Address = prefetch.NextAddress;
+    prefetch.Length = prefetch.Stats.Block;
+
+    if (prefetch.Length > (CYPRESS_FLASH_SIZE - prefetch.Address))
+    {
+        prefetch.Length = CYPRESS_FLASH_SIZE - prefetch.Address;
+    }
+    prefetch.Used = 0;
+    prefetch.SavedRxCplt = hqspi->RxCpltCallback;
+    prefetch.SavedError = hqspi->ErrorCallback;
+
+    if ((HAL_QSPI_RegisterCallback(hqspi, HAL_QSPI_RX_CPLT_CB_ID, Cypress_QSPI_PrefetchRxCplt) != HAL_OK) ||
+        (HAL_QSPI_RegisterCallback(hqspi, HAL_QSPI_ERROR_CB_ID, Cypress_QSPI_PrefetchError) != HAL_OK))
+    {
+        Cypress_QSPI_PrefetchRestore(hqspi);
+        prefetch.State = 0;
+        return HAL_OK;
+    }
+
+    prefetch.State = 1;
+
+    if (Cypress_QSPI_ReadQuad_DMA(hqspi, prefetch.Address, prefetch.Buffer, prefetch.Length) != HAL_OK)
+    {
+        // The requested data is already in dest, so only the read-ahead is lost
+        Cypress_QSPI_PrefetchRestore(hqspi);
+        prefetch.State = 0;
+        return HAL_OK;
+    }
+
+    prefetch.Stats.Issued++;
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Waits for any prefetch in flight and drops the prefetched block
+* @param   hqspi: QSPI handle
+* @return  HAL status
+* @note    Call before issuing other commands while sequential reads are in progress
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_PrefetchInvalidate(QSPI_HandleTypeDef *hqspi)
+{
+    HAL_StatusTypeDef status = Cypress_QSPI_PrefetchWait(hqspi);
+
+    Cypress_QSPI_PrefetchDrop();
+    prefetch.NextAddress = 0xFFFFFFFF;
+    prefetch.Sequential = 0;
+
+    return status;
+}
+
+/**
+* @brief   Gets the read-ahead counters
+* @param   stats: Location to store the counters
+*/
+
+void Cypress_QSPI_GetPrefetchStats(Cypress_QSPI_PrefetchStats *stats)
+{
+    *stats = prefetch.Stats;
+}
+
+/**
+* @brief   Clears the read-ahead counters, keeping the current prefetch size
+*/
+
+void Cypress_QSPI_ResetPrefetchStats(void)
+{
+    prefetch.Stats.Requests = 0;
+    prefetch.Stats.Hits = 0;
+    prefetch.Stats.PartialHits = 0;
+    prefetch.Stats.Issued = 0;
+    prefetch.Stats.Wasted = 0;
+}
+#endif
+
+/**
+* @brief   Writes data into a page in SPI mode (blocking)
+* @param   hqspi: QSPI handle
+* @param   address: page to write
+* @param   src: pointer to data to write
+* @param   count: bytes to write
+* @return  HAL status
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_Program(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count)
+{
+    CACHE_INVALIDATE(address, count);
+    PREFETCH_INVALIDATE(hqspi);
+
+    Cypress_QSPI_WriteEnable(hqspi);
+
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_PAGE_PROGRAM, address, count) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (HAL_QSPI_Transmit(hqspi, src, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    // Verify no errors occured during the write
+    if  (Cypress_QSPI_CheckForErrors(hqspi) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Writes data into a page in SPI mode (nonblocking, requires callbacks)
+* @param   hqspi: QSPI handle
+* @param   address: page to write
+* @param   src: pointer to data to write
+* @param   count: bytes to write
+* @return  HAL status
+* @post    User should verify that no errors were raised after the write
+* @remark  Calls HAL_QSPI_TxCpltCallback on completion via interrupt
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_Program_IT(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count)
+{
+    CACHE_INVALIDATE(address, count);
+    PREFETCH_INVALIDATE(hqspi);
+
+    Cypress_QSPI_WriteEnable(hqspi);
+
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_PAGE_PROGRAM, address, count) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    // This will call HAL_QSPI_TxCpltCallback when complete
+    if (HAL_QSPI_Transmit_IT(hqspi, src) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+    // User should verify after the callback that no errors were raised
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Writes data into a page in SPI mode (nonblocking, requires callbacks)
+* @param   hqspi: QSPI handle
+* @param   address: page to write
+* @param   src: pointer to data to write
+* @param   count: bytes to write
+* @return  HAL status
+* @post    User should verify that no errors were raised after the write
+* @remark  Calls HAL_QSPI_TxCpltCallback on completion via interrupt
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_Program_DMA(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count)
+{
+    CACHE_INVALIDATE(address, count);
+    PREFETCH_INVALIDATE(hqspi);
+
+    Cypress_QSPI_WriteEnable(hqspi);
+
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_PAGE_PROGRAM, address, count) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    // This will call HAL_QSPI_TxCpltCallback when complete
+    if (HAL_QSPI_Transmit_DMA(hqspi, src) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+    // User should verify after the callback that no errors were raised
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Writes data into a page using QSPI (blocking)
+* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
+* @param   hqspi: QSPI handle
+* @param   address: page to write
+* @param   src: pointer to data to write
+* @param   count: bytes to write
+* @return  HAL status
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ProgramQuad(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count)
+{
+    CACHE_INVALIDATE(address, count);
+    PREFETCH_INVALIDATE(hqspi);
+
+    Cypress_QSPI_WriteEnable(hqspi);
+
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_QUAD_PROGRAM, address, count) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (HAL_QSPI_Transmit(hqspi, src, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    // Verify no errors occured during the write
+    if  (Cypress_QSPI_CheckForErrors(hqspi) != HAL_OK) {
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Writes data into a page using QSPI (non-blocking, requires callbacks)
+* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
+* @param   hqspi: QSPI handle
+* @param   address: page to write
+* @param   src: pointer to data to write
+* @param   count: bytes to write
+* @return  HAL status
+* @post    User should verify that no errors were raised after the write
+* @remark  Calls HAL_QSPI_TxCpltCallback on completion via interrupt
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ProgramQuad_IT(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count)
+{
+    CACHE_INVALIDATE(address, count);
+    PREFETCH_INVALIDATE(hqspi);
+
+    Cypress_QSPI_WriteEnable(hqspi);
+
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_QUAD_PROGRAM, address, count) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    // This will call HAL_QSPI_TxCpltCallback when complete
+    if (HAL_QSPI_Transmit_IT(hqspi, src) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+    // User should verify after the callback that no errors were raised
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Writes data into a page using QSPI (non-blocking, requires callbacks)
+* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
+* @param   hqspi: QSPI handle
+* @param   address: page to write
+* @param   src: pointer to data to write
+* @param   count: bytes to write
+* @return  HAL status
+* @post    User should verify that no errors were raised after the write
+* @remark  Calls HAL_QSPI_TxCpltCallback on completion via interrupt
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ProgramQuad_DMA(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count)
+{
+    CACHE_INVALIDATE(address, count);
+    PREFETCH_INVALIDATE(hqspi);
+
+    // Without WEL the program is ignored and TxCplt would still fire
+    if (Cypress_QSPI_WriteEnable(hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_QUAD_PROGRAM, address, count) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    // This will call HAL_QSPI_TxCpltCallback when complete
+    if (HAL_QSPI_Transmit_DMA(hqspi, src) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+    // User should verify after the callback that no errors were raised
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Writes any range of data using QSPI, split into page programs (blocking)
+* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
+* @param   hqspi: QSPI handle
+* @param   address: starting address to write
+* @param   src: pointer to data to write
+* @param   count: bytes to write
+* @return  HAL status
+* @note    Each program stays inside one CYPRESS_PAGE_SIZE page, so nothing wraps around within a page
+* @post    If error, call Cypress_QSPI_ErrorRecovery to clear errors
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ProgramRange(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count)
+{
+    while (count > 0)
+    {
+        // Up to the end of the current page
+        uint32_t chunk = CYPRESS_PAGE_SIZE - (address & (CYPRESS_PAGE_SIZE - 1));
+
+        if (chunk > count)
+        {
+            chunk = count;
+        }
+
+        if (Cypress_QSPI_ProgramQuad(hqspi, address, src, chunk) != HAL_OK)
+        {
+            return HAL_ERROR;
+        }
+
+        if (Cypress_QSPI_WaitMemReady(hqspi, PAGE_PROGRAM_MAX_TIME) != HAL_OK)
+        {
+            return HAL_ERROR;
+        }
+
+        // P_ERR is only valid once the program has finished
+        if (Cypress_QSPI_CheckForErrors(hqspi) != HAL_OK)
+        {
+            return HAL_ERROR;
+        }
+
+        address += chunk;
+        src += chunk;
+        count -= chunk;
+    }
+
+    return HAL_OK;
+}
+
+#if (CYPRESS_WRITE_COMBINE == 1)
+/**
+* @brief   Applies pending combined writes to data read from the flash
+* @param   address: flash address the data was read from
+* @param   dest: data read
+* @param   count: bytes read
+* @note    A program can only clear bits, so the pending bytes are ANDed in, exactly as the flush will do
+*/
+
+static void Cypress_QSPI_WriteCombineOverlay(uint32_t address, uint8_t *dest, uint32_t count)
+{
+    uint32_t start = writeCombine.Page + writeCombine.Low;
+    uint32_t end = writeCombine.Page + writeCombine.High;
+
+    if (!writeCombine.Pending || (address >= end) || ((address + count) <= start))
+    {
+        return;
+    }
+
+    for (uint32_t flash = (address > start) ? address : start; (flash < end) && (flash < (address + count)); flash++)
+    {
+        dest[flash - address] &= writeCombine.Data[flash - writeCombine.Page];
+    }
+}
+
+/**
+* @brief   Drops pending combined writes to a range that is being erased
+* @param   address: starting address of the erase
+* @param   count: bytes erased, 0 for the whole flash
+*/
+
+static void Cypress_QSPI_WriteCombineDiscard(uint32_t address, uint32_t count)
+{
+    if (writeCombine.Pending && ((count == 0) || ((writeCombine.Page >= address) && (writeCombine.Page < (address + count)))))
+    {
+        writeCombine.Pending = 0;
+    }
+}
+
+/**
+* @brief   Writes data through the write-combining buffer (blocking only when a page is written out)
+* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
+* @param   hqspi: QSPI handle
+* @param   address: starting address to write
+* @param   src: pointer to data to write
+* @param   count: bytes to write
+* @return  HAL status, HAL_BUSY while a stream or vectored read is running since its later reads are not flushed
+* @note    Writes to the same page are merged in RAM. The page is programmed once it is full, when a write goes to
+*          another page, on \ref Cypress_QSPI_Flush, or once \ref Cypress_QSPI_FlushIfIdle sees no writes for
+*          CYPRESS_WRITE_COMBINE_TIMEOUT ms.
+* @note    Blocking reads through the driver see pending writes; IT/DMA and memory-mapped reads flush first
+* @post    If error, call Cypress_QSPI_ErrorRecovery to clear errors
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ProgramCombined(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count)
+{
+#if (USE_HAL_QSPI_REGISTER_CALLBACKS == 1)
+    if ((stream.Status == HAL_BUSY) || (readV.Status == HAL_BUSY))
+    {
+        return HAL_BUSY;
+    }
+#endif
+
+    while (count > 0)
+    {
+        uint32_t page = address & ~(CYPRESS_PAGE_SIZE - 1);
+        uint32_t offset = address - page;
+        uint32_t chunk = CYPRESS_PAGE_SIZE - offset;
+
+        if (chunk > count)
+        {
+            chunk = count;
+        }
+
+        if (writeCombine.Pending && (writeCombine.Page != page))
+        {
+            if (Cypress_QSPI_Flush(hqspi) != HAL_OK)
+            {
+                return HAL_ERROR;
+            }
+        }
+
+        if (!writeCombine.Pending)
+        {
+            for (uint32_t i = 0; i < CYPRESS_PAGE_SIZE; i++)
+            {
+                writeCombine.Data[i] = 0xFF;
+            }
+
+            for (uint32_t i = 0; i < (CYPRESS_PAGE_SIZE / 8); i++)
+            {
+                writeCombine.Mask[i] = 0;
+            }
+
+            writeCombine.Page = page;
+            writeCombine.Low = offset;
+            writeCombine.High = offset + chunk;
+            writeCombine.Written = 0;
+            writeCombine.Pending = 1;
+        }
+
+        for (uint32_t i = offset; i < (offset + chunk); i++)
+        {
+            writeCombine.Data[i] &= src[i - offset];
+
+            if (!(writeCombine.Mask[i / 8] & (1 << (i % 8))))
+            {
+                writeCombine.Mask[i / 8] |= (1 << (i % 8));
+                writeCombine.Written++;
+            }
+        }
+
+        if (offset < writeCombine.Low)
+        {
+            writeCombine.Low = offset;
+        }
+
+        if ((offset + chunk) > writeCombine.High)
+        {
+            writeCombine.High = offset + chunk;
+        }
+
+        writeCombine.LastWrite = HAL_GetTick();
+
+        // Cache hits do not go through the overlay
+        CACHE_INVALIDATE(address, chunk);
+
+        if (writeCombine.Written == CYPRESS_PAGE_SIZE)
+        {
+            if (Cypress_QSPI_Flush(hqspi) != HAL_OK)
+            {
+                return HAL_ERROR;
+            }
+        }
+
+        address += chunk;
+        src += chunk;
+        count -= chunk;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Programs any pending combined writes (blocking)
+* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
+* @param   hqspi: QSPI handle
+* @return  HAL status
+* @note    Only the span between the first and last written byte is sent; unwritten bytes in it are 0xFF
+* @post    If error, call Cypress_QSPI_ErrorRecovery to clear errors
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_Flush(QSPI_HandleTypeDef *hqspi)
+{
+    if (!writeCombine.Pending)
+    {
+        return HAL_OK;
+    }
+
+    if (Cypress_QSPI_ProgramRange(hqspi, writeCombine.Page + writeCombine.Low, &writeCombine.Data[writeCombine.Low], writeCombine.High - writeCombine.Low) != HAL_OK)
+    {
+        // Kept pending, so the flush can be retried after recovery
+        return HAL_ERROR;
+    }
+
+    writeCombine.Pending = 0;
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Programs pending combined writes once no write has arrived for CYPRESS_WRITE_COMBINE_TIMEOUT ms
+* @param   hqspi: QSPI handle
+* @return  HAL status
+* @note    Call periodically, e.g. from the main loop
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_FlushIfIdle(QSPI_HandleTypeDef *hqspi)
+{
+    if (writeCombine.Pending && ((HAL_GetTick() - writeCombine.LastWrite) >= CYPRESS_WRITE_COMBINE_TIMEOUT))
+    {
+        return Cypress_QSPI_Flush(hqspi);
+    }
+
+    return HAL_OK;
+}
+#endif
+
+/**
+* @brief   Compares flash contents with memory using QSPI (blocking)
+* @param   hqspi: QSPI handle
+* @param   address: starting address to compare
+* @param   src: pointer to data to compare against
+* @param   count: bytes to compare
+* @param   result: set to COMPARE_SAME, COMPARE_CLEAR_ONLY or COMPARE_NEEDS_ERASE
+* @return  HAL status
+* @note    COMPARE_CLEAR_ONLY means the new data only turns 1 bits into 0, which a program can do without an erase
+*/
+
+static HAL_StatusTypeDef Cypress_QSPI_Compare(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count, uint8_t *result)
+{
+    uint8_t buffer[CYPRESS_PAGE_SIZE];
+
+    *result = COMPARE_SAME;
+
+    while (count > 0)
+    {
+        uint32_t chunk = (count < CYPRESS_PAGE_SIZE) ? count : CYPRESS_PAGE_SIZE;
+
+        if (Cypress_QSPI_ReadQuad(hqspi, address, buffer, chunk) != HAL_OK)
+        {
+            return HAL_ERROR;
+        }
+
+        for (uint32_t i = 0; i < chunk; i++)
+        {
+            if (src[i] & ~buffer[i])
+            {
+                // A 0 bit would have to become 1
+                *result = COMPARE_NEEDS_ERASE;
+                return HAL_OK;
+            }
+
+            if (src[i] != buffer[i])
+            {
+                *result = COMPARE_CLEAR_ONLY;
+            }
+        }
+
+        address += chunk;
+        src += chunk;
+        count -= chunk;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Checks whether a block of memory is all 0xFF, i.e. already matches an erased page
+* @param   src: pointer to data
+* @param   count: bytes to check
+* @return  1 if blank, 0 otherwise
+*/
+
+static uint8_t Cypress_QSPI_IsBlank(uint8_t *src, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (src[i] != 0xFF)
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/**
+* @brief   Programs the pages of a range that differ, without erasing (blocking)
+* @param   hqspi: QSPI handle
+* @param   address: starting address
+* @param   src: pointer to the new data
+* @param   count: bytes to update
+* @param   result: counters to add to
+* @return  HAL status
+* @pre     Every byte of the new data must only clear bits of the current contents
+*/
+
+static HAL_StatusTypeDef Cypress_QSPI_ProgramChanges(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count, Cypress_QSPI_UpdateStats *result)
+{
+    uint8_t compare;
+
+    while (count > 0)
+    {
+        // Up to the end of the current page
+        uint32_t chunk = CYPRESS_PAGE_SIZE - (address & (CYPRESS_PAGE_SIZE - 1));
+
+        if (chunk > count)
+        {
+            chunk = count;
+        }
+
+        if (Cypress_QSPI_Compare(hqspi, address, src, chunk, &compare) != HAL_OK)
+        {
+            return HAL_ERROR;
+        }
+
+        if (compare == COMPARE_SAME)
+        {
+            result->PagesSkipped++;
+        }
+        else
+        {
+            if (Cypress_QSPI_ProgramRange(hqspi, address, src, chunk) != HAL_OK)
+            {
+                return HAL_ERROR;
+            }
+
+            result->PagesProgrammed++;
+            result->BytesWritten += chunk;
+        }
+
+        address += chunk;
+        src += chunk;
+        count -= chunk;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Estimates the time saved against erasing and programming every sector and page of a range
+* @param   sectors: sectors covered by the range
+* @param   pages: pages covered by the range
+* @param   result: what was actually done
+* @return  estimated ms saved, from typical times
+*/
+
+static uint32_t Cypress_QSPI_UpdateTimeSaved(uint32_t sectors, uint32_t pages, const Cypress_QSPI_UpdateStats *result)
+{
+    uint32_t full = (sectors * SECTOR_ERASE_TYP_TIME) + (pages * PAGE_PROGRAM_TYP_TIME_US) / 1000;
+    uint32_t done = (result->SectorsErased * SECTOR_ERASE_TYP_TIME) + (result->PagesProgrammed * PAGE_PROGRAM_TYP_TIME_US) / 1000;
+
+    return (full > done) ? (full - done) : 0;
+}
+
+/**
+* @brief   Writes an image over whole sectors, only erasing and programming where it differs (blocking)
+* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
+* @param   hqspi: QSPI handle
+* @param   address: starting address, aligned to CYPRESS_SECTOR_SIZE
+* @param   src: pointer to the new image
+* @param   count: bytes to write, a multiple of CYPRESS_SECTOR_SIZE
+* @param   stats: Location to store what was done, may be NULL
+* @return  HAL status
+* @note    Each sector is read back and compared first. Matching sectors are left alone, sectors where the image
+*          only clears bits have their changed pages programmed in place, and the others are erased and only their
+*          non-blank pages are programmed.
+* @note    Whole sectors are required, as a differing sector may be erased completely
+* @note    See \ref Cypress_QSPI_UpdateInPlace about ECC on in-place updates
+* @post    If error, call Cypress_QSPI_ErrorRecovery to clear errors
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_UpdateRange(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count, Cypress_QSPI_UpdateStats *stats)
+{
+    Cypress_QSPI_UpdateStats result = { 0 };
+    uint8_t compare;
+
+    if (((address | count) & (CYPRESS_SECTOR_SIZE - 1)) != 0)
+    {
+        return HAL_ERROR;
+    }
+
+    for (uint32_t sector = 0; sector < count; sector += CYPRESS_SECTOR_SIZE)
+    {
+        if (Cypress_QSPI_Compare(hqspi, address + sector, src + sector, CYPRESS_SECTOR_SIZE, &compare) != HAL_OK)
+        {
+            return HAL_ERROR;
+        }
+
+        if (compare == COMPARE_SAME)
+        {
+            result.SectorsSkipped++;
+            continue;
+        }
+
+        if (compare == COMPARE_CLEAR_ONLY)
+        {
+            if (Cypress_QSPI_ProgramChanges(hqspi, address + sector, src + sector, CYPRESS_SECTOR_SIZE, &result) != HAL_OK)
+            {
+                return HAL_ERROR;
+            }
+
+            result.SectorsInPlace++;
+            continue;
+        }
+
+        if (Cypress_QSPI_SectorErase(hqspi, address + sector) != HAL_OK)
+        {
+            return HAL_ERROR;
+        }
+
+        result.SectorsErased++;
+
+        for (uint32_t page = sector; page < (sector + CYPRESS_SECTOR_SIZE); page += CYPRESS_PAGE_SIZE)
+        {
+            if (Cypress_QSPI_IsBlank(src + page, CYPRESS_PAGE_SIZE))
+            {
+                result.PagesSkipped++;
+                continue;
+            }
+
+            if (Cypress_QSPI_ProgramRange(hqspi, address + page, src + page, CYPRESS_PAGE_SIZE) != HAL_OK)
+            {
+                return HAL_ERROR;
+            }
+
+            result.PagesProgrammed++;
+            result.BytesWritten += CYPRESS_PAGE_SIZE;
+        }
+    }
+
+    result.TimeSaved = Cypress_QSPI_UpdateTimeSaved(count / CYPRESS_SECTOR_SIZE, count / CYPRESS_PAGE_SIZE, &result);
+
+    if (stats != NULL)
+    {
+        *stats = result;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Updates any range without erasing, when the new data only clears bits (blocking)
+* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
+* @param   hqspi: QSPI handle
+* @param   address: starting address
+* @param   src: pointer to the new data
+* @param   count: bytes to update
+* @param   stats: Location to store what was done, may be NULL
+* @return  HAL status, HAL_ERROR without writing anything if some bit would have to go from 0 to 1
+* @note    Suits bitmaps, flags and counters that only ever clear bits; only the pages that changed are programmed
+* @note    FL-S ECC is computed per 16-byte unit on its first program. Programming a unit again disables ECC for it
+*          until the next erase, so data relying on ECC should use \ref Cypress_QSPI_UpdateRange instead.
+* @post    If error, call Cypress_QSPI_ErrorRecovery to clear errors
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_UpdateInPlace(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count, Cypress_QSPI_UpdateStats *stats)
+{
+    Cypress_QSPI_UpdateStats result = { 0 };
+    uint8_t compare;
+
+    if (count == 0)
+    {
+        return HAL_ERROR;
+    }
+
+    // Check everything first, so nothing is written if the update cannot be done in place
+    if (Cypress_QSPI_Compare(hqspi, address, src, count, &compare) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (compare == COMPARE_NEEDS_ERASE)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_ProgramChanges(hqspi, address, src, count, &result) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (compare == COMPARE_SAME)
+    {
+        result.SectorsSkipped = ((address + count - 1) / CYPRESS_SECTOR_SIZE) - (address / CYPRESS_SECTOR_SIZE) + 1;
+    }
+    else
+    {
+        result.SectorsInPlace = ((address + count - 1) / CYPRESS_SECTOR_SIZE) - (address / CYPRESS_SECTOR_SIZE) + 1;
+    }
+
+    result.TimeSaved = Cypress_QSPI_UpdateTimeSaved(result.SectorsSkipped + result.SectorsInPlace, result.PagesProgrammed + result.PagesSkipped, &result);
+
+    if (stats != NULL)
+    {
+        *stats = result;
+    }
+
+    return HAL_OK;
+}
+
+#if (USE_HAL_QSPI_REGISTER_CALLBACKS == 1)
+/**
+* @brief   Ends a pipelined range program and gives the QSPI callbacks back to the application
+* @param   hqspi: QSPI handle
+* @param   status: final status passed to the completion callback
+*/
+
+static void Cypress_QSPI_ProgramEngineFinish(QSPI_HandleTypeDef *hqspi, HAL_StatusTypeDef status)
+{
+    HAL_QSPI_RegisterCallback(hqspi, HAL_QSPI_TX_CPLT_CB_ID, programEngine.SavedTxCplt);
+    HAL_QSPI_RegisterCallback(hqspi, HAL_QSPI_STATUS_MATCH_CB_ID, programEngine.SavedStatusMatch);
+    HAL_QSPI_RegisterCallback(hqspi, HAL_QSPI_ERROR_CB_ID, programEngine.SavedError);
+    programEngine.Status = status;
+
+    if (programEngine.Callback != NULL)
+    {
+        programEngine.Callback(status);
+    }
+}
+
+/**
+* @brief   Starts programming the next page of a pipelined range program
+* @param   hqspi: QSPI handle
+* @return  HAL status, HAL_ERROR if WREN or the program could not be sent
+* @note    Called from the StatusMatch interrupt, so the cache and prefetch are invalidated once for the whole range
+*          by \ref Cypress_QSPI_ProgramRange_DMA instead of per page
+*/
+
+static HAL_StatusTypeDef Cypress_QSPI_ProgramEngineNext(QSPI_HandleTypeDef *hqspi)
+{
+    // Up to the end of the current page
+    programEngine.Pending = CYPRESS_PAGE_SIZE - (programEngine.Address & (CYPRESS_PAGE_SIZE - 1));
+
+    if (programEngine.Pending > programEngine.Remaining)
+    {
+        programEngine.Pending = programEngine.Remaining;
+    }
+
+    // Without WEL the program is ignored and TxCplt would still fire
+    if (Cypress_QSPI_WriteEnable(hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_QUAD_PROGRAM, programEngine.Address, programEngine.Pending) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    return HAL_QSPI_Transmit_DMA(hqspi, programEngine.Src);
+}
+
+/**
+* @brief   TxCplt callback while a range program is running, starts polling WIP
+* @param   hqspi: QSPI handle
+*/
+
+static void Cypress_QSPI_ProgramEngineTxCplt(QSPI_HandleTypeDef *hqspi)
+{
+    if (Cypress_QSPI_WaitMemReady_IT(hqspi) != HAL_OK)
+    {
+        Cypress_QSPI_ProgramEngineFinish(hqspi, HAL_ERROR);
+    }
+}
+
+/**
+* @brief   StatusMatch callback while a range program is running, checks the page and starts the next one
+* @param   hqspi: QSPI handle
+* @note    The status read and WREN are short register-level commands with the \ref QSPI_FAST_PATH enabled
+*/
+
+static void Cypress_QSPI_ProgramEngineStatusMatch(QSPI_HandleTypeDef *hqspi)
+{
+    // P_ERR is only valid once the program has finished
+    if (Cypress_QSPI_CheckForErrors(hqspi) != HAL_OK)
+    {
+        Cypress_QSPI_ProgramEngineFinish(hqspi, HAL_ERROR);
+        return;
+    }
+
+    programEngine.Address += programEngine.Pending;
+    programEngine.Src += programEngine.Pending;
+    programEngine.Remaining -= programEngine.Pending;
+
+    if (programEngine.Remaining == 0)
+    {
+        Cypress_QSPI_ProgramEngineFinish(hqspi, HAL_OK);
+        return;
+    }
+
+    // A failed WREN or program aborts the rest of the range
+    if (Cypress_QSPI_ProgramEngineNext(hqspi) != HAL_OK)
+    {
+        Cypress_QSPI_ProgramEngineFinish(hqspi, HAL_ERROR);
+    }
+}
+
+/**
+* @brief   Error callback while a range program is running
+* @param   hqspi: QSPI handle
+* @remark  The application's error callback is still called
+*/
+
+static void Cypress_QSPI_ProgramEngineError(QSPI_HandleTypeDef *hqspi)
+{
+    Cypress_QSPI_ProgramEngineFinish(hqspi, HAL_ERROR);
+    programEngine.SavedError(hqspi);
+}
+
+/**
+* @brief   Writes any range of data using QSPI, with every page chained from the interrupts (nonblocking)
+* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
+* @pre     Register callbacks must be enabled for QUADSPI
+* @param   hqspi: QSPI handle
+* @param   address: starting address to write
+* @param   src: pointer to data to write, must stay valid until completion
+* @param   count: bytes to write
+* @param   callback: called once from the QSPI interrupt when the whole range is done, may be NULL
+* @return  HAL status
+* @note    Each page runs TxCplt, then a WIP auto-poll, then the P_ERR check, WREN and the next page, without main-loop
+*          involvement. Without a callback, poll \ref Cypress_QSPI_GetProgramRangeStatus.
+* @warning With the \ref QSPI_FAST_PATH disabled, the P_ERR check and WREN go through HAL_QSPI_Command from the
+*          interrupt, which waits on the HAL tick
+* @remark  The TxCplt, StatusMatch and Error callbacks are borrowed until the range is done
+* @post    If error, call Cypress_QSPI_ErrorRecovery to clear errors
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ProgramRange_DMA(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count, Cypress_QSPI_CompleteCallback callback)
+{
+    if (programEngine.Status == HAL_BUSY)
+    {
+        return HAL_BUSY;
+    }
+
+    if ((count == 0) || (src == NULL))
+    {
+        return HAL_ERROR;
+    }
+
+#if defined(__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
+    // The DMA reads from RAM, so write back anything still in the D-cache, from the start of the first cache line
+    SCB_CleanDCache_by_Addr((uint32_t *)((uintptr_t)src & ~(uintptr_t)31), (int32_t)(count + ((uintptr_t)src & 31)));
+#endif
+
+    // Once for the whole range, as the pages are started from the interrupt
+    CACHE_INVALIDATE(address, count);
+    PREFETCH_INVALIDATE(hqspi);
+
+    programEngine.Address = address;
+    programEngine.Src = src;
+    programEngine.Remaining = count;
+    programEngine.Callback = callback;
+    programEngine.SavedTxCplt = hqspi->TxCpltCallback;
+    programEngine.SavedStatusMatch = hqspi->StatusMatchCallback;
+    programEngine.SavedError = hqspi->ErrorCallback;
+
+    if ((HAL_QSPI_RegisterCallback(hqspi, HAL_QSPI_TX_CPLT_CB_ID, Cypress_QSPI_ProgramEngineTxCplt) != HAL_OK) ||
+        (HAL_QSPI_RegisterCallback(hqspi, HAL_QSPI_STATUS_MATCH_CB_ID, Cypress_QSPI_ProgramEngineStatusMatch) != HAL_OK) ||
+        (HAL_QSPI_RegisterCallback(hqspi, HAL_QSPI_ERROR_CB_ID, Cypress_QSPI_ProgramEngineError) != HAL_OK))
+    {
+        programEngine.Callback = NULL;
+        Cypress_QSPI_ProgramEngineFinish(hqspi, HAL_ERROR);
+        return HAL_ERROR;
+    }
+
+    programEngine.Status = HAL_BUSY;
+
+    if (Cypress_QSPI_ProgramEngineNext(hqspi) != HAL_OK)
+    {
+        // Nothing was started, so the callback is not called
+        programEngine.Callback = NULL;
+        Cypress_QSPI_ProgramEngineFinish(hqspi, HAL_ERROR);
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Gets the state of the last pipelined range program
+* @return  HAL_BUSY while running, HAL_OK once every page was programmed, HAL_ERROR if it failed
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_GetProgramRangeStatus(void)
+{
+    return programEngine.Status;
+}
+#endif
+
+/**
+* @brief   Resets device to power-up state
+* @param   hqspi: QSPI handle
+* @return  HAL status
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_Reset(QSPI_HandleTypeDef *hqspi)
+{
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_SOFTWARE_RESET, 0, 0) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Forces device into normal mode after continuous high performance read mode
+* @param   hqspi: QSPI handle
+* @return  HAL status
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ModeBitReset(QSPI_HandleTypeDef *hqspi)
+{
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_MODE_BIT_RESET, 0, 0) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Sets all configuration to default
+* @warn    This will unset the QUAD bit and may result in write protection being set; see \ref Cypress_QSPI_DisableWP
+* @param   hqspi: QSPI handle
+* @return  HAL status
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ResetConfiguration(QSPI_HandleTypeDef *hqspi)
+{
+    Cypress_QSPI_WriteEnable(hqspi);
+
+    uint8_t defaultConfig[] = { 0U, 0U };
+
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_WRITE_REGISTERS, 0, 2) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (HAL_QSPI_Transmit(hqspi, defaultConfig, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    Cypress_QSPI_WaitMemReady(hqspi, HAL_QSPI_TIMEOUT_DEFAULT_VALUE);
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Copies the latency code and dummy cycles of one latency table row into a profile
+* @param   profile: timing profile to update
+* @param   row: index into latencyTable
+*/
+
+static void Cypress_QSPI_SetLatency(Cypress_QSPI_TimingProfile *profile, uint32_t row)
+{
+    profile->LatencyCode        = latencyTable[row].LatencyCode;
+    profile->DummyFastRead      = latencyTable[row].DummyFastRead;
+    profile->DummyDual          = latencyTable[row].DummyDual;
+    profile->DummyDualIO        = latencyTable[row].DummyDualIO;
+    profile->DummyQuad          = latencyTable[row].DummyQuad;
+    profile->DummyQuadIO        = latencyTable[row].DummyQuadIO;
+    profile->DummyFastReadDDR   = latencyTable[row].DummyFastReadDDR;
+    profile->DummyQuadIODDR     = latencyTable[row].DummyQuadIODDR;
+}
+
+/**
+* @brief   Computes the timing profile for a given QSPI clock
+* @param   kernelClock: QSPI kernel clock in Hz
+* @param   prescaler: QSPI clock prescaler, SCK = kernelClock / (prescaler + 1)
+* @param   profile: Location to store the timing profile
+* @return  HAL status, HAL_ERROR if SCK is above what any latency code supports
+* @note    The lowest latency code rated for SCK is chosen; sample shifting and DDR hold are kept from the active profile
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ComputeTimingProfile(uint32_t kernelClock, uint32_t prescaler, Cypress_QSPI_TimingProfile *profile)
+{
+    uint32_t frequency = kernelClock / (prescaler + 1);
+
+    for (uint32_t i = 0; i < (sizeof(latencyTable) / sizeof(latencyTable[0])); i++)
+    {
+        if (frequency <= latencyTable[i].MaxFrequency)
+        {
+            profile->ClockPrescaler     = prescaler;
+            profile->SampleShifting     = activeTiming.SampleShifting;
+            profile->DdrHoldHalfCycle   = activeTiming.DdrHoldHalfCycle;
+            Cypress_QSPI_SetLatency(profile, i);
+            return HAL_OK;
+        }
+    }
+
+    return HAL_ERROR;
+}
+
+/**
+* @brief   Applies the peripheral half of a timing profile
+* @param   hqspi: QSPI handle
+* @param   profile: timing profile
+* @return  HAL status
+* @pre     CR1 already holds the latency code of the profile
+*/
+
+static HAL_StatusTypeDef Cypress_QSPI_SetPeripheralTiming(QSPI_HandleTypeDef *hqspi, const Cypress_QSPI_TimingProfile *profile)
+{
+    hqspi->Init.ClockPrescaler = profile->ClockPrescaler;
+    hqspi->Init.SampleShifting = profile->SampleShifting;
+
+    if (HAL_QSPI_Init(hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    activeTiming = *profile;
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Applies a timing profile to the flash and the QSPI peripheral
+* @param   hqspi: QSPI handle
+* @param   profile: timing profile, from \ref Cypress_QSPI_ComputeTimingProfile or \ref Cypress_QSPI_CalibrateTiming
+* @return  HAL status
+* @note    The latency code in CR1 is only rewritten when it changes. It is non-volatile, so avoid toggling it often.
+* @note    When the kernel clock is about to rise, apply the profile for the new clock before the change;
+*          when it is about to fall, apply it after the change
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ApplyTimingProfile(QSPI_HandleTypeDef *hqspi, const Cypress_QSPI_TimingProfile *profile)
+{
+    uint8_t configRegister;
+
+    if (Cypress_QSPI_ReadCR(hqspi, &configRegister) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if ((configRegister & CR1_LC_MASK) != profile->LatencyCode)
+    {
+        MODIFY_REG(configRegister, CR1_LC_MASK, profile->LatencyCode);
+
+        if (Cypress_QSPI_WriteCR(hqspi, configRegister) != HAL_OK)
+        {
+            return HAL_ERROR;
+        }
+
+        if (Cypress_QSPI_WaitMemReady(hqspi, WRITE_REGISTER_MAX_TIME) != HAL_OK)
+        {
+            return HAL_ERROR;
+        }
+    }
+
+    return Cypress_QSPI_SetPeripheralTiming(hqspi, profile);
+}
+
+/**
+* @brief   Recomputes and applies the timing profile for the current QSPI kernel clock
+* @param   hqspi: QSPI handle
+* @return  HAL status
+* @note    Call after changing the system clocks, e.g. for DVFS; the prescaler is left unchanged
+* @note    The current latency code is kept while it is rated for the new clock, so slowing down never writes CR1.
+*          Only a clock above its rating costs a WRR.
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_UpdateTimingProfile(QSPI_HandleTypeDef *hqspi)
+{
+    uint32_t kernelClock = HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_QSPI);
+    uint32_t frequency = kernelClock / (hqspi->Init.ClockPrescaler + 1);
+    Cypress_QSPI_TimingProfile profile;
+
+    if (Cypress_QSPI_ComputeTimingProfile(kernelClock, hqspi->Init.ClockPrescaler, &profile) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    for (uint32_t i = 0; i < (sizeof(latencyTable) / sizeof(latencyTable[0])); i++)
+    {
+        if ((latencyTable[i].LatencyCode == activeTiming.LatencyCode) && (frequency <= latencyTable[i].MaxFrequency))
+        {
+            Cypress_QSPI_SetLatency(&profile, i);
+        }
+    }
+
+    return Cypress_QSPI_ApplyTimingProfile(hqspi, &profile);
+}
+
+/**
+* @brief   Gets the timing profile used by the read functions
+* @param   hqspi: QSPI handle
+* @param   profile: Location to store the timing profile
+* @note    The prescaler and sample shift are taken from the handle, so the profile can be re-applied
+*          even if \ref Cypress_QSPI_ApplyTimingProfile was never called
+*/
+
+void Cypress_QSPI_GetTimingProfile(QSPI_HandleTypeDef *hqspi, Cypress_QSPI_TimingProfile *profile)
+{
+    activeTiming.ClockPrescaler = hqspi->Init.ClockPrescaler;
+    activeTiming.SampleShifting = hqspi->Init.SampleShifting;
+
+    *profile = activeTiming;
+}
+
+/**
+* @brief   Checks SDR sampling at the current peripheral timing
+* @param   hqspi: QSPI handle
+* @param   address: address the reference was read from
+* @param   reference: data read from address at known-good timing
+* @return  1 if every read matched, 0 otherwise
+*/
+
+static uint8_t Cypress_QSPI_CheckTimingSDR(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *reference)
+{
+    uint8_t buffer[CYPRESS_CALIBRATION_SIZE];
+    uint8_t pattern;
+
+    for (uint32_t pass = 0; pass < CYPRESS_CALIBRATION_PASSES; pass++)
+    {
+        if ((Cypress_QSPI_ReadDLR(hqspi, &pattern) != HAL_OK) || (pattern != CYPRESS_DLP_PATTERN))
+        {
+            return 0;
+        }
+
+        if (Cypress_QSPI_ReadQuad(hqspi, address, buffer, CYPRESS_CALIBRATION_SIZE) != HAL_OK)
+        {
+            return 0;
+        }
+
+        for (uint32_t i = 0; i < CYPRESS_CALIBRATION_SIZE; i++)
+        {
+            if (buffer[i] != reference[i])
+            {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+/**
+* @brief   Checks DDR sampling at the current peripheral timing using the Data Learning Pattern
+* @param   hqspi: QSPI handle
+* @return  1 if every preamble matched, 0 otherwise
+* @note    The last 4 dummy clocks of a DDR Quad I/O read are moved into the data phase, so the
+*          DLP driven on all four lines is captured as 4 data bytes
+*/
+
+static uint8_t Cypress_QSPI_CheckTimingDDR(QSPI_HandleTypeDef *hqspi)
+{
+    QSPI_CommandTypeDef sCommand;
+    uint8_t expected[4];
+    uint8_t preamble[4];
+
+    // Each DDR edge carries one DLP bit (MSB first) on all four lines, i.e. one nibble
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        expected[i]  = (CYPRESS_DLP_PATTERN & (0x80 >> (2 * i))) ? 0xF0 : 0x00;
+        expected[i] |= (CYPRESS_DLP_PATTERN & (0x40 >> (2 * i))) ? 0x0F : 0x00;
+    }
+
+    Cypress_QSPI_BuildCommand(CMD_READ_QUAD_IO_DDR, 0, sizeof(preamble), &sCommand);
+    sCommand.DummyCycles -= 4;
+
+    for (uint32_t pass = 0; pass < CYPRESS_CALIBRATION_PASSES; pass++)
+    {
+        if (HAL_QSPI_Command(hqspi, &sCommand, HAL_QSPI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+        {
+            return 0;
+        }
+
+        if (HAL_QSPI_Receive(hqspi, preamble, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+        {
+            return 0;
+        }
+
+        for (uint32_t i = 0; i < sizeof(preamble); i++)
+        {
+            if (preamble[i] != expected[i])
+            {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+/**
+* @brief   Finds a working sample shift and DDR hold for one prescaler
+* @param   hqspi: QSPI handle
+* @param   address: address the reference was read from
+* @param   reference: data read from address at known-good timing
+* @param   prescaler: QSPI clock prescaler to test
+* @param   result: Location to store the working settings
+* @return  1 if a working setting was found, 0 otherwise
+*/
+
+static uint8_t Cypress_QSPI_FindTiming(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *reference,
+                                       uint32_t prescaler, Cypress_QSPI_TimingProfile *result)
+{
+    // No shift first, since DDR reads require it
+    const uint32_t shifts[] = { QSPI_SAMPLE_SHIFTING_NONE, QSPI_SAMPLE_SHIFTING_HALFCYCLE };
+    // 1/4 clock hold first, as it is the FL-S recommendation
+    const uint32_t holds[] = { QSPI_DDR_HHC_HALF_CLK_DELAY, QSPI_DDR_HHC_ANALOG_DELAY };
+    uint8_t found = 0;
+
+    *result = activeTiming;
+    result->ClockPrescaler = prescaler;
+
+    for (uint32_t i = 0; (i < 2) && !found; i++)
+    {
+        hqspi->Init.ClockPrescaler = prescaler;
+        hqspi->Init.SampleShifting = shifts[i];
+        if (HAL_QSPI_Init(hqspi) != HAL_OK)
+        {
+            return 0;
+        }
+
+        if (Cypress_QSPI_CheckTimingSDR(hqspi, address, reference))
+        {
+            result->SampleShifting = shifts[i];
+            found = 1;
+        }
+    }
+
+    // The DLP only fits if the latency code gives at least 4 DDR dummy clocks
+    if (!found || (activeTiming.DummyQuadIODDR < 4))
+    {
+        return found;
+    }
+
+    hqspi->Init.SampleShifting = QSPI_SAMPLE_SHIFTING_NONE;
+    if (HAL_QSPI_Init(hqspi) != HAL_OK)
+    {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        activeTiming.DdrHoldHalfCycle = holds[i];
+        if (Cypress_QSPI_CheckTimingDDR(hqspi))
+        {
+            result->DdrHoldHalfCycle = holds[i];
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+* @brief   Sweeps the prescaler down from its current value, see \ref Cypress_QSPI_CalibrateTiming
+* @param   hqspi: QSPI handle
+* @param   address: address of readable data used as a reference
+* @param   minPrescaler: fastest prescaler allowed
+* @param   profile: Location to store the chosen timing
+* @return  HAL status
+* @post    The DLR holds CYPRESS_DLP_PATTERN and the peripheral timing may have changed, even on failure
+*/
+
+static HAL_StatusTypeDef Cypress_QSPI_CalibrationSweep(QSPI_HandleTypeDef *hqspi, uint32_t address, uint32_t minPrescaler, Cypress_QSPI_TimingProfile *profile)
+{
+    uint32_t kernelClock = HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_QSPI);
+    uint32_t originalPrescaler = hqspi->Init.ClockPrescaler;
+    Cypress_QSPI_TimingProfile best;
+    Cypress_QSPI_TimingProfile previous;
+    Cypress_QSPI_TimingProfile candidate;
+    uint8_t reference[CYPRESS_CALIBRATION_SIZE];
+    uint8_t limited = 0;
+
+    // The latency code for the fastest clock is valid at every slower one, so CR1 is written once for the sweep
+    if (Cypress_QSPI_ComputeTimingProfile(kernelClock, minPrescaler, &best) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    best.ClockPrescaler = originalPrescaler;
+    best.SampleShifting = hqspi->Init.SampleShifting;
+
+    if (Cypress_QSPI_ApplyTimingProfile(hqspi, &best) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    previous = best;
+
+    // Capture the reference data and DLR at the known-good clock
+    if (Cypress_QSPI_ReadQuad(hqspi, address, reference, CYPRESS_CALIBRATION_SIZE) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_WriteDLR(hqspi, CYPRESS_DLP_PATTERN) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    // Step towards faster clocks until a prescaler fails
+    for (uint32_t prescaler = originalPrescaler + 1; prescaler-- > minPrescaler; )
+    {
+        if (!Cypress_QSPI_FindTiming(hqspi, address, reference, prescaler, &candidate))
+        {
+            limited = 1;
+            break;
+        }
+
+        previous = best;
+        best = candidate;
+    }
+
+    // Timing limited the sweep, so stay one step away from the failing setting
+    if (limited && (best.ClockPrescaler != originalPrescaler))
+    {
+        best = previous;
+    }
+
+    // Keep the latency code of the sweep, it is rated for the chosen clock and is already in CR1
+    *profile = best;
+
+    return Cypress_QSPI_ApplyTimingProfile(hqspi, profile);
+}
+
+/**
+* @brief   Finds the fastest stable QSPI timing using the Data Learning Pattern (blocking)
+* @pre     CR1 must have CR1_QUAD set (0x02) to enable quad mode
+* @pre     The current peripheral configuration must be known to work
+* @param   hqspi: QSPI handle
+* @param   address: address of readable data used as a reference, preferably not erased
+* @param   minPrescaler: fastest prescaler allowed, limited by the flash rating
+* @param   profile: Location to store the chosen timing
+* @return  HAL status
+* @note    The prescaler is stepped down from its current value while every read matches.
+*          If a setting fails, the result backs off one step to leave margin.
+* @note    The chosen profile, including the matching latency code, is applied before returning.
+*          On failure the original timing is applied again. The DLR is restored either way.
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_CalibrateTiming(QSPI_HandleTypeDef *hqspi, uint32_t address, uint32_t minPrescaler, Cypress_QSPI_TimingProfile *profile)
+{
+    Cypress_QSPI_TimingProfile original;
+    HAL_StatusTypeDef status;
+    uint8_t savedDLR;
+
+    Cypress_QSPI_GetTimingProfile(hqspi, &original);
+
+    if (minPrescaler > original.ClockPrescaler)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_ReadDLR(hqspi, &savedDLR) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    status = Cypress_QSPI_CalibrationSweep(hqspi, address, minPrescaler, profile);
+
+    if ((status != HAL_OK) && (Cypress_QSPI_ApplyTimingProfile(hqspi, &original) != HAL_OK))
+    {
+        status = HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_WriteDLR(hqspi, savedDLR) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    return status;
+}
+
+/**
+* @brief   Picks the fastest read mode the device and the current setup allow
+* @param   dev: device context, with capabilities, shadow CR1 and timing filled in
+* @note    Quad modes need CR1_QUAD. DDR also needs SCK at or below CYPRESS_DDR_MAX_FREQUENCY and no sample shifting.
+*/
+
+static void Cypress_QSPI_SelectReadMode(Cypress_QSPI_Device *dev)
+{
+    uint32_t frequency = HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_QSPI) / (dev->Timing.ClockPrescaler + 1);
+
+    if ((dev->CR1 & CR1_QUAD) && (dev->Capabilities & CYPRESS_CAP_QUAD_IO))
+    {
+        if ((dev->Capabilities & CYPRESS_CAP_DDR) && (frequency <= CYPRESS_DDR_MAX_FREQUENCY) &&
+            (dev->Timing.SampleShifting == QSPI_SAMPLE_SHIFTING_NONE))
+        {
+            dev->ReadMode = CYPRESS_READ_QUAD_IO_DDR;
+        }
+        else
+        {
+            dev->ReadMode = CYPRESS_READ_QUAD_IO;
+        }
+    }
+    else if ((dev->CR1 & CR1_QUAD) && (dev->Capabilities & CYPRESS_CAP_QUAD))
+    {
+        dev->ReadMode = CYPRESS_READ_QUAD;
+    }
+    else if (dev->Capabilities & CYPRESS_CAP_DUAL_IO)
+    {
+        dev->ReadMode = CYPRESS_READ_DUAL_IO;
+    }
+    else if (dev->Capabilities & CYPRESS_CAP_DUAL)
+    {
+        dev->ReadMode = CYPRESS_READ_DUAL;
+    }
+    else
+    {
+        dev->ReadMode = CYPRESS_READ;
+    }
+}
+
+/**
+* @brief   Sets up a device context and reads SR1 and CR1 into its shadows
+* @param   dev: device context to fill
+* @param   hqspi: QSPI handle
+* @return  HAL status
+* @note    Geometry comes from the CYPRESS_ geometry constants and the timing from \ref Cypress_QSPI_GetTimingProfile.
+*          Use \ref Cypress_QSPI_DeviceProbe to read the geometry from the device instead.
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_DeviceInit(Cypress_QSPI_Device *dev, QSPI_HandleTypeDef *hqspi)
+{
+    dev->hqspi = hqspi;
+    dev->DeviceId = 0;
+    dev->FlashSize = CYPRESS_FLASH_SIZE;
+    dev->SectorSize = CYPRESS_SECTOR_SIZE;
+    dev->PageSize = CYPRESS_PAGE_SIZE;
+    dev->ParamSectorCount = CYPRESS_PARAM_SECTOR_COUNT;
+
+    dev->SectorEraseTime = SECTOR_ERASE_MAX_TIME;
+    dev->BulkEraseTime = BULK_ERASE_MAX_TIME;
+
+    dev->Capabilities = CYPRESS_CAP_DUAL | CYPRESS_CAP_DUAL_IO | CYPRESS_CAP_QUAD | CYPRESS_CAP_QUAD_IO | CYPRESS_CAP_DDR | CYPRESS_CAP_SUSPEND;
+    if (CYPRESS_PARAM_SECTOR_COUNT > 0)
+    {
+        dev->Capabilities |= CYPRESS_CAP_PARAM_SECTORS;
+    }
+
+    Cypress_QSPI_GetTimingProfile(hqspi, &dev->Timing);
+
+    if (Cypress_QSPI_DevRefresh(dev) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    Cypress_QSPI_SelectReadMode(dev);
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Re-reads SR1 and CR1 into the shadows of a device context
+* @param   dev: device context
+* @return  HAL status
+* @note    Needed after the registers were written without the context, e.g. by \ref Cypress_QSPI_WriteCR or a reset
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_DevRefresh(Cypress_QSPI_Device *dev)
+{
+    uint8_t statusRegister;
+
+    if (Cypress_QSPI_ReadSR1(dev->hqspi, &statusRegister) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_ReadCR(dev->hqspi, &dev->CR1) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    dev->SR1 = statusRegister & (SR1_BP0 | SR1_BP1 | SR1_BP2 | SR1_SRWD);
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Writes SR1 and CR1 in one WRR, skipping it if both already hold the values
+* @param   dev: device context
+* @param   sReg: status to write
+* @param   cReg: configuration to write
+* @return  HAL status
+* @note    Waits for the write to finish, so the shadows always match the device on return
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_DevWriteRegisters(Cypress_QSPI_Device *dev, uint8_t sReg, uint8_t cReg)
+{
+    uint8_t payload[] = { sReg, cReg };
+
+    if ((sReg == dev->SR1) && (cReg == dev->CR1))
+    {
+        return HAL_OK;
+    }
+
+    if (Cypress_QSPI_WriteEnable(dev->hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_IssueCommand(dev->hqspi, CMD_WRITE_REGISTERS, 0, 2) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (HAL_QSPI_Transmit(dev->hqspi, payload, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_WaitMemReady(dev->hqspi, WRITE_REGISTER_MAX_TIME) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_CheckForErrors(dev->hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    dev->SR1 = sReg & (SR1_BP0 | SR1_BP1 | SR1_BP2 | SR1_SRWD);
+    dev->CR1 = cReg;
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Writes to SR1, keeping CR1 from the shadow
+* @param   dev: device context
+* @param   sReg: status to write
+* @return  HAL status
+* @note    Unlike \ref Cypress_QSPI_WriteSR1 this always sends CR1 too, so a 1-byte WRR cannot clear CR1
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_DevWriteSR1(Cypress_QSPI_Device *dev, uint8_t sReg)
+{
+    return Cypress_QSPI_DevWriteRegisters(dev, sReg, dev->CR1);
+}
+
+/**
+* @brief   Writes to CR, taking SR1 from the shadow instead of reading it
+* @param   dev: device context
+* @param   cReg: configuration to write
+* @return  HAL status
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_DevWriteCR(Cypress_QSPI_Device *dev, uint8_t cReg)
+{
+    return Cypress_QSPI_DevWriteRegisters(dev, dev->SR1, cReg);
+}
+
+/**
+* @brief   Sets CR1_QUAD if it is not already set
+* @param   dev: device context
+* @return  HAL status
+* @note    CR1_QUAD is non-volatile, so after the first boot this costs no bus traffic
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_DevEnableQuad(Cypress_QSPI_Device *dev)
+{
+    if (Cypress_QSPI_DevWriteCR(dev, dev->CR1 | CR1_QUAD) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    Cypress_QSPI_SelectReadMode(dev);
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Checks CR1_QUAD in the shadow
+* @param   dev: device context
+* @return  1 if Quad mode is enabled, 0 otherwise
+*/
+
+uint8_t Cypress_QSPI_DevIsQuadEnabled(const Cypress_QSPI_Device *dev)
+{
+    return (dev->CR1 & CR1_QUAD) ? 1 : 0;
+}
+
+/**
+* @brief   Applies a timing profile, using the shadow CR1 for the latency code
+* @param   dev: device context
+* @param   profile: timing profile, from \ref Cypress_QSPI_ComputeTimingProfile or \ref Cypress_QSPI_CalibrateTiming
+* @return  HAL status
+* @note    See \ref Cypress_QSPI_ApplyTimingProfile. Skips its CR1 read, and the SR1 read of the WRR.
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_DevApplyTimingProfile(Cypress_QSPI_Device *dev, const Cypress_QSPI_TimingProfile *profile)
+{
+    uint8_t configRegister = dev->CR1;
+
+    MODIFY_REG(configRegister, CR1_LC_MASK, profile->LatencyCode);
+
+    if (Cypress_QSPI_DevWriteCR(dev, configRegister) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_SetPeripheralTiming(dev->hqspi, profile) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    dev->Timing = *profile;
+    Cypress_QSPI_SelectReadMode(dev);
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Finds the erase block containing an address, using the shadow CR1_TBPARM
+* @param   dev: device context
+* @param   address: address to look up, replaced by the start of its erase block
+* @param   size: Location to store the size of the erase block
+* @note    See \ref Cypress_QSPI_GetEraseBlock, which reads CR1 on every call
+* @note    Uses the geometry of the context, so it also follows a probed layout
+*/
+
+void Cypress_QSPI_DevGetEraseBlock(const Cypress_QSPI_Device *dev, uint32_t *address, uint32_t *size)
+{
+    uint32_t paramSize = dev->ParamSectorCount * CYPRESS_PARAM_SECTOR_SIZE;
+    uint32_t paramStart = (dev->CR1 & CR1_TBPARM) ? (dev->FlashSize - paramSize) : 0;
+
+    if ((paramSize > 0) && (*address >= paramStart) && (*address < (paramStart + paramSize)))
+    {
+        *size = CYPRESS_PARAM_SECTOR_SIZE;
+    }
+    else
+    {
+        *size = dev->SectorSize;
+    }
+
+    *address &= ~(*size - 1);
+}
+
+/**
+* @brief   Erases the block containing an address, using the geometry of the context (blocking)
+* @param   dev: device context
+* @param   address: address within the block to erase
+* @return  HAL status, HAL_ERROR if the address is outside the array
+* @note    Sends a 4 KB parameter erase or a sector erase, as found by \ref Cypress_QSPI_DevGetEraseBlock.
+*          A sector erase waits up to the SectorEraseTime of the context.
+* @post    If error, call Cypress_QSPI_ErrorRecovery to clear errors
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_DevEraseBlock(Cypress_QSPI_Device *dev, uint32_t address)
+{
+    uint32_t size;
+    uint8_t parameter;
+
+    if (address >= dev->FlashSize)
+    {
+        return HAL_ERROR;
+    }
+
+    Cypress_QSPI_DevGetEraseBlock(dev, &address, &size);
+    parameter = (size == CYPRESS_PARAM_SECTOR_SIZE) ? 1 : 0;
+
+    CACHE_INVALIDATE(address, size);
+    WRITE_COMBINE_DISCARD(address, size);
+    PREFETCH_INVALIDATE(dev->hqspi);
+
+    if (Cypress_QSPI_WriteEnable(dev->hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_IssueCommand(dev->hqspi, parameter ? CMD_PARAM_ERASE : CMD_SECTOR_ERASE, address, 0) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_WaitMemReady(dev->hqspi, parameter ? PARAM_SECTOR_ERASE_MAX_TIME : dev->SectorEraseTime) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    // E_ERR is only valid once the erase has finished
+    if (Cypress_QSPI_CheckForErrors(dev->hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Sets all bits in the array to 1, waiting up to the BulkEraseTime of the context (blocking)
+* @param   dev: device context
+* @return  HAL status
+* @post    If error, call Cypress_QSPI_ErrorRecovery to clear errors
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_DevBulkErase(Cypress_QSPI_Device *dev)
+{
+    CACHE_INVALIDATE_ALL();
+    WRITE_COMBINE_DISCARD(0, 0);
+    PREFETCH_INVALIDATE(dev->hqspi);
+
+    if (Cypress_QSPI_WriteEnable(dev->hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_IssueCommand(dev->hqspi, CMD_BULK_ERASE, 0, 0) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_WaitMemReady(dev->hqspi, dev->BulkEraseTime) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    // If any block protection bits are set, this will fail
+    if (Cypress_QSPI_CheckForErrors(dev->hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Writes any range of data, split at the page size of the context (blocking)
+* @param   dev: device context
+* @param   address: starting address to write
+* @param   src: pointer to data to write
+* @param   count: bytes to write
+* @return  HAL status, HAL_ERROR if the range does not fit in the array
+* @note    Uses Quad page programs when CR1_QUAD is set in the shadow, SPI page programs otherwise
+* @post    If error, call Cypress_QSPI_ErrorRecovery to clear errors
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_DevProgramRange(Cypress_QSPI_Device *dev, uint32_t address, uint8_t *src, uint32_t count)
+{
+    HAL_StatusTypeDef status;
+
+    if ((address >= dev->FlashSize) || (count > (dev->FlashSize - address)))
+    {
+        return HAL_ERROR;
+    }
+
+    while (count > 0)
+    {
+        // Up to the end of the current page
+        uint32_t chunk = dev->PageSize - (address & (dev->PageSize - 1));
+
+        if (chunk > count)
+        {
+            chunk = count;
+        }
+
+        if (dev->CR1 & CR1_QUAD)
+        {
+            status = Cypress_QSPI_ProgramQuad(dev->hqspi, address, src, chunk);
+        }
+        else
+        {
+            status = Cypress_QSPI_Program(dev->hqspi, address, src, chunk);
+        }
+
+        if (status != HAL_OK)
+        {
+            return HAL_ERROR;
+        }
+
+        if (Cypress_QSPI_WaitMemReady(dev->hqspi, PAGE_PROGRAM_MAX_TIME) != HAL_OK)
+        {
+            return HAL_ERROR;
+        }
+
+        // P_ERR is only valid once the program has finished
+        if (Cypress_QSPI_CheckForErrors(dev->hqspi) != HAL_OK)
+        {
+            return HAL_ERROR;
+        }
+
+        address += chunk;
+        src += chunk;
+        count -= chunk;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Reads the JEDEC ID and the ID-CFI block after it
+* @param   hqspi: QSPI handle
+* @param   dest: pointer to memory destination
+* @param   count: bytes to read, from 3 for the JEDEC ID up to the 0x50 byte ID-CFI block
+* @return  HAL status
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ReadID(QSPI_HandleTypeDef *hqspi, uint8_t *dest, uint32_t count)
+{
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_READ_ID, 0, count) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (HAL_QSPI_Receive(hqspi, dest, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Reads the Serial Flash Discoverable Parameters
+* @param   hqspi: QSPI handle
+* @param   address: SFDP address to read from
+* @param   dest: pointer to memory destination
+* @param   count: bytes to read
+* @return  HAL status
+* @note    Always 24-bit addresses and 8 dummy cycles, whatever the latency code
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_ReadSFDP(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count)
+{
+    if (Cypress_QSPI_IssueCommand(hqspi, CMD_READ_SFDP, address, count) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (HAL_QSPI_Receive(hqspi, dest, HAL_QPSI_TIMEOUT_DEFAULT_VALUE) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Fills a device context from the ID-CFI block
+* @param   dev: device context
+* @param   id: ID-CFI block, CYPRESS_ID_CFI_SIZE bytes
+* @return  HAL status, HAL_ERROR if it is not a Cypress part with CFI
+*/
+
+static HAL_StatusTypeDef Cypress_QSPI_ParseIdCfi(Cypress_QSPI_Device *dev, const uint8_t *id)
+{
+    uint32_t regions = id[0x2C];
+
+    if ((id[0x00] != CYPRESS_MANUFACTURER_ID) || (id[0x10] != 'Q') || (id[0x11] != 'R') || (id[0x12] != 'Y'))
+    {
+        return HAL_ERROR;
+    }
+
+    dev->DeviceId = ((uint16_t)id[0x01] << 8) | id[0x02];
+    dev->FlashSize = (uint32_t)1 << id[0x27];
+    dev->PageSize = (uint32_t)1 << id[0x2A];
+
+    // Erase times are 2^N ms typical, times 2^N for the maximum; 0 means not supported
+    if (id[0x21] != 0)
+    {
+        dev->SectorEraseTime = ((uint32_t)1 << id[0x21]) << id[0x25];
+    }
+    if (id[0x22] != 0)
+    {
+        dev->BulkEraseTime = ((uint32_t)1 << id[0x22]) << id[0x26];
+    }
+
+    // Each erase region is (sectors - 1) and (sector size / 256), both 16-bit little endian
+    dev->SectorSize = 0;
+    dev->ParamSectorCount = 0;
+
+    if (regions > 4)
+    {
+        regions = 4;
+    }
+
+    for (uint32_t i = 0; i < regions; i++)
+    {
+        const uint8_t *region = &id[0x2D + (4 * i)];
+        uint32_t sectors = (region[0] | ((uint32_t)region[1] << 8)) + 1;
+        uint32_t size = (region[2] | ((uint32_t)region[3] << 8)) * 256;
+
+        if (size == CYPRESS_PARAM_SECTOR_SIZE)
+        {
+            dev->ParamSectorCount += sectors;
+        }
+        else if (size > dev->SectorSize)
+        {
+            dev->SectorSize = size;
+        }
+    }
+
+    if (dev->SectorSize == 0)
+    {
+        return HAL_ERROR;
+    }
+
+    MODIFY_REG(dev->Capabilities, CYPRESS_CAP_PARAM_SECTORS, (dev->ParamSectorCount > 0) ? CYPRESS_CAP_PARAM_SECTORS : 0);
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Fills the read modes and density of a device context from the SFDP basic flash parameter table
+* @param   dev: device context
+* @return  HAL status, HAL_OK without changes if the device has no SFDP
+*/
+
+static HAL_StatusTypeDef Cypress_QSPI_ParseSfdp(Cypress_QSPI_Device *dev)
+{
+    uint32_t header[4];
+    uint32_t table[2];
+    uint32_t modes = 0;
+
+    // The tables are little endian, like the Cortex-M7
+    if (Cypress_QSPI_ReadSFDP(dev->hqspi, 0, (uint8_t *)header, sizeof(header)) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    // The first parameter header is always the basic flash parameter table, at least two DWORDs long
+    if ((header[0] != CYPRESS_SFDP_SIGNATURE) || ((header[2] >> 24) < 2))
+    {
+        return HAL_OK;
+    }
+
+    if (Cypress_QSPI_ReadSFDP(dev->hqspi, header[3] & 0x00FFFFFF, (uint8_t *)table, sizeof(table)) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    // DWORD 1 has a support bit for each fast read mode
+    for (uint32_t i = 0; i < (sizeof(sfdpReadModes) / sizeof(sfdpReadModes[0])); i++)
+    {
+        if (table[0] & sfdpReadModes[i].Bit)
+        {
+            modes |= sfdpReadModes[i].Capability;
+        }
+    }
+
+    MODIFY_REG(dev->Capabilities, CYPRESS_CAP_DUAL | CYPRESS_CAP_DUAL_IO | CYPRESS_CAP_QUAD | CYPRESS_CAP_QUAD_IO | CYPRESS_CAP_DDR, modes);
+
+    // Density in bits, either N - 1 or 2^N with bit 31 set; only the first form fits a 4 GB address space
+    if (!(table[1] & 0x80000000))
+    {
+        dev->FlashSize = (table[1] + 1) / 8;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Sets up a device context from the JEDEC ID, the ID-CFI block and SFDP
+* @param   dev: device context to fill
+* @param   hqspi: QSPI handle
+* @return  HAL status, HAL_ERROR if the probed geometry differs from the CYPRESS_ constants
+* @note    Fills the density, page size, sector layout, erase times and read modes, then picks the fastest read mode
+* @note    The functions taking a QSPI handle, and the cache, pool and write-combining layers built on them, use the
+*          compile-time CYPRESS_ geometry. A part whose flash, sector or page size or parameter sector count differs
+*          is refused; the context is still filled so the caller can see what was found.
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_DeviceProbe(Cypress_QSPI_Device *dev, QSPI_HandleTypeDef *hqspi)
+{
+    uint8_t id[CYPRESS_ID_CFI_SIZE];
+
+    if (Cypress_QSPI_DeviceInit(dev, hqspi) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_ReadID(hqspi, id, sizeof(id)) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_ParseIdCfi(dev, id) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    if (Cypress_QSPI_ParseSfdp(dev) != HAL_OK)
+    {
+        return HAL_ERROR;
+    }
+
+    Cypress_QSPI_SelectReadMode(dev);
+
+    if ((dev->FlashSize != CYPRESS_FLASH_SIZE) || (dev->SectorSize != CYPRESS_SECTOR_SIZE) ||
+        (dev->PageSize != CYPRESS_PAGE_SIZE) || (dev->ParamSectorCount != CYPRESS_PARAM_SECTOR_COUNT))
+    {
+        // The handle API would address the part with the wrong layout
+        return HAL_ERROR;
+    }
+
+    return HAL_OK;
+}
+
+/**
+* @brief   Reads data into memory with the read mode picked for the device (blocking)
+* @param   dev: device context
+* @param   address: starting address to read
+* @param   dest: pointer to memory destination
+* @param   count: bytes to read
+* @return  HAL status
+*/
+
+HAL_StatusTypeDef Cypress_QSPI_DevRead(Cypress_QSPI_Device *dev, uint32_t address, uint8_t *dest, uint32_t count)
+{
+    switch (dev->ReadMode)
+    {
+    case CYPRESS_READ_QUAD_IO_DDR:
+        return Cypress_QSPI_ReadQuadDDR(dev->hqspi, address, dest, count);
+    case CYPRESS_READ_QUAD_IO:
+        return Cypress_QSPI_ReadQuad(dev->hqspi, address, dest, count);
+    case CYPRESS_READ_QUAD:
+        return Cypress_QSPI_ReadQuadAlt(dev->hqspi, address, dest, count);
+    case CYPRESS_READ_DUAL_IO:
+        return Cypress_QSPI_ReadDualIO(dev->hqspi, address, dest, count);
+    case CYPRESS_READ_DUAL:
+        return Cypress_QSPI_ReadDual(dev->hqspi, address, dest, count);
+    default:
+        return Cypress_QSPI_Read(dev->hqspi, address, dest, count);
+    }
+}
+
 /**
 * @brief   Disables Write Protection
 * @note    When the QUAD bit is not set, IO2/WP acts as a write protect.
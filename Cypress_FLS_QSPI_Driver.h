@@ -11,6 +11,160 @@
 #include "stm32h7xx_hal.h"
 #endif
 
+/* Type defines */
+
+/**
+* @brief   QSPI timing used by every read function
+* @note    Built by \ref Cypress_QSPI_ComputeTimingProfile or \ref Cypress_QSPI_CalibrateTiming
+* @note    Plain data, so it can be stored and re-applied at boot with \ref Cypress_QSPI_ApplyTimingProfile
+*/
+typedef struct
+{
+    uint32_t ClockPrescaler;        /*!< QSPI kernel clock prescaler, SCK = kernel / (ClockPrescaler + 1) */
+    uint32_t SampleShifting;        /*!< QSPI_SAMPLE_SHIFTING_NONE or QSPI_SAMPLE_SHIFTING_HALFCYCLE for SDR reads */
+    uint32_t DdrHoldHalfCycle;      /*!< QSPI_DDR_HHC_ANALOG_DELAY or QSPI_DDR_HHC_HALF_CLK_DELAY for DDR reads */
+    uint8_t  LatencyCode;           /*!< CR1_LC0 to CR1_LC3 */
+    uint8_t  DummyFastRead;         /*!< Dummy clock cycles for FASTREAD reads */
+    uint8_t  DummyDual;             /*!< Dummy clock cycles for DUAL reads */
+    uint8_t  DummyDualIO;           /*!< Dummy clock cycles for DUALIO reads */
+    uint8_t  DummyQuad;             /*!< Dummy clock cycles for QUAD reads */
+    uint8_t  DummyQuadIO;           /*!< Dummy clock cycles for QUADIO reads */
+    uint8_t  DummyFastReadDDR;      /*!< Dummy clock cycles for DDR FASTREAD reads */
+    uint8_t  DummyQuadIODDR;        /*!< Dummy clock cycles for DDR QUADIO reads */
+} Cypress_QSPI_TimingProfile;
+
+/**
+* @brief   Read cache counters, see \ref QSPI_CACHE
+*/
+typedef struct
+{
+    uint32_t Hits;                  /*!< Lines served from the cache */
+    uint32_t Misses;                /*!< Lines read from the flash */
+    uint32_t Evictions;             /*!< Valid lines replaced by a miss */
+    uint32_t Uncached;              /*!< DMA reads sent to the flash whole because a line was missing */
+} Cypress_QSPI_CacheStats;
+
+/**
+* @brief   Read-ahead counters, see \ref QSPI_PREFETCH
+*/
+typedef struct
+{
+    uint32_t Requests;              /*!< Calls to \ref Cypress_QSPI_ReadQuadPrefetch */
+    uint32_t Hits;                  /*!< Requests served entirely from the prefetch buffer */
+    uint32_t PartialHits;           /*!< Requests that started in the prefetch buffer but needed more data */
+    uint32_t Issued;                /*!< Prefetches started */
+    uint32_t Wasted;                /*!< Prefetched blocks dropped without being used */
+    uint32_t Block;                 /*!< Current prefetch size in bytes */
+} Cypress_QSPI_PrefetchStats;
+
+/**
+* @brief   Result of \ref Cypress_QSPI_UpdateRange
+*/
+typedef struct
+{
+    uint32_t SectorsErased;         /*!< Sectors that differed and were erased */
+    uint32_t SectorsSkipped;        /*!< Sectors that already matched */
+    uint32_t SectorsInPlace;        /*!< Sectors where the new data only cleared bits, programmed without an erase */
+    uint32_t PagesProgrammed;       /*!< Pages programmed */
+    uint32_t PagesSkipped;          /*!< Pages left alone, as they were blank after an erase or already matched */
+    uint32_t BytesWritten;          /*!< Bytes sent to the flash in page programs */
+    uint32_t TimeSaved;             /*!< Estimated ms saved against erasing and programming everything, from typical times */
+} Cypress_QSPI_UpdateStats;
+
+/**
+* @brief   Erase manager counters, see \ref Cypress_QSPI_ManagedErase
+*/
+typedef struct
+{
+    uint32_t Erases;                /*!< Managed erases completed */
+    uint32_t Suspends;              /*!< Times an erase was suspended to serve reads or programs */
+    uint32_t Programs;              /*!< Programs done while an erase was suspended */
+    uint32_t SuspendedTime;         /*!< Total ms erases spent suspended, i.e. the time added to them */
+} Cypress_QSPI_EraseStats;
+
+/**
+* @brief   Erases chosen by \ref Cypress_QSPI_EraseRange
+*/
+typedef struct
+{
+    uint32_t ParameterErases;       /*!< 4 KB parameter sector erases */
+    uint32_t SectorErases;          /*!< Sector erases */
+    uint8_t  BulkErase;             /*!< 1 if the range is the whole array and is erased with a bulk erase */
+    uint32_t EstimatedTime;         /*!< Typical ms to erase the range */
+} Cypress_QSPI_ErasePlan;
+
+/**
+* @brief   Called with the progress of \ref Cypress_QSPI_EraseRange after each block
+*/
+typedef void (*Cypress_QSPI_ProgressCallback)(uint32_t done, uint32_t total);
+
+/**
+* @brief   Pre-erase pool state, see \ref Cypress_QSPI_PoolInit
+*/
+typedef struct
+{
+    uint32_t Erased;                /*!< Sectors erased and ready to claim */
+    uint32_t InUse;                 /*!< Sectors claimed and not yet released */
+    uint32_t Dirty;                 /*!< Sectors waiting for an erase */
+    uint32_t Claims;                /*!< Successful claims */
+    uint32_t Misses;                /*!< Claims that found no erased sector */
+} Cypress_QSPI_PoolStats;
+
+/**
+* @brief   Called when a claim leaves fewer erased sectors in the pool than the low watermark
+*/
+typedef void (*Cypress_QSPI_PoolCallback)(uint32_t erased);
+
+/**
+* @brief   Called with each finished chunk of \ref Cypress_QSPI_ReadStream
+* @param   chunk: buffer holding the chunk
+* @param   address: flash address of the first byte in the chunk
+* @param   count: bytes in the chunk
+* @warning The next chunk is already being read into the other buffer, and this one is reused for the chunk after.
+*          Copy or consume the data before returning; do not keep the pointer.
+*/
+typedef void (*Cypress_QSPI_ChunkCallback)(uint8_t *chunk, uint32_t address, uint32_t count);
+
+/**
+* @brief   One region of a \ref Cypress_QSPI_ReadV
+*/
+typedef struct
+{
+    uint32_t Address;               /*!< Flash address to read from */
+    uint8_t *Dest;                  /*!< Pointer to memory destination */
+    uint32_t Count;                 /*!< Bytes to read, 0 to skip the descriptor */
+} Cypress_QSPI_ReadDescriptor;
+
+/**
+* @brief   Called once when a nonblocking multi-step operation is done
+* @param   status: HAL_OK on success, HAL_ERROR otherwise
+*/
+typedef void (*Cypress_QSPI_CompleteCallback)(HAL_StatusTypeDef status);
+
+/**
+* @brief   Device context, see \ref Cypress_QSPI_DeviceInit and \ref Cypress_QSPI_DeviceProbe
+* @note    Keeps shadow copies of SR1 and CR1 so the Dev functions can skip register reads.
+*          Only the driver should write the registers while a context is in use; otherwise call \ref Cypress_QSPI_DevRefresh.
+* @note    Only the Cypress_QSPI_Dev functions use the erase times held here. Every function taking a QSPI handle
+*          assumes the compile-time CYPRESS_ geometry, so \ref Cypress_QSPI_DeviceProbe fails on a part that differs.
+*/
+typedef struct
+{
+    QSPI_HandleTypeDef *hqspi;      /*!< QSPI handle */
+    uint16_t DeviceId;              /*!< JEDEC device ID, 0 if not probed */
+    uint32_t FlashSize;             /*!< Bytes in the array */
+    uint32_t SectorSize;            /*!< Bytes in a uniform sector */
+    uint32_t PageSize;              /*!< Bytes in a program page */
+    uint32_t ParamSectorCount;      /*!< Number of CYPRESS_PARAM_SECTOR_SIZE parameter sectors */
+    uint32_t Capabilities;          /*!< CYPRESS_CAP flags */
+    uint32_t SectorEraseTime;       /*!< Maximum sector erase time in ms */
+    uint32_t BulkEraseTime;         /*!< Maximum bulk erase time in ms */
+    uint8_t  ReadMode;              /*!< CYPRESS_READ mode used by \ref Cypress_QSPI_DevRead */
+    Cypress_QSPI_TimingProfile Timing; /*!< Timing profile in use */
+    uint8_t  SR1;                   /*!< Shadow of the non-volatile SR1 bits (BP2-0, SRWD) */
+    uint8_t  CR1;                   /*!< Shadow of CR1 */
+} Cypress_QSPI_Device;
+
 /* Function defines */
 
 HAL_StatusTypeDef Cypress_QSPI_WriteEnable(QSPI_HandleTypeDef *hqspi);
@@ -28,11 +182,39 @@ HAL_StatusTypeDef Cypress_QSPI_ClearSR(QSPI_HandleTypeDef *hqspi);
 HAL_StatusTypeDef Cypress_QSPI_CheckForErrors(QSPI_HandleTypeDef *hqspi);
 HAL_StatusTypeDef Cypress_QSPI_WriteCR(QSPI_HandleTypeDef *hqspi, uint8_t cReg);
 HAL_StatusTypeDef Cypress_QSPI_WriteSR1(QSPI_HandleTypeDef *hqspi, uint8_t sReg);
+HAL_StatusTypeDef Cypress_QSPI_ReadDLR(QSPI_HandleTypeDef *hqspi, uint8_t *result);
+HAL_StatusTypeDef Cypress_QSPI_WriteDLR(QSPI_HandleTypeDef *hqspi, uint8_t pattern);
+HAL_StatusTypeDef Cypress_QSPI_ProgramDLR(QSPI_HandleTypeDef *hqspi, uint8_t pattern);
 
 HAL_StatusTypeDef Cypress_QSPI_SectorErase(QSPI_HandleTypeDef *hqspi, uint32_t address);
 HAL_StatusTypeDef Cypress_QSPI_SectorErase_IT(QSPI_HandleTypeDef *hqspi, uint32_t address);
+HAL_StatusTypeDef Cypress_QSPI_GetEraseBlock(QSPI_HandleTypeDef *hqspi, uint32_t *address, uint32_t *size);
+HAL_StatusTypeDef Cypress_QSPI_PlanEraseRange(QSPI_HandleTypeDef *hqspi, uint32_t start, uint32_t length, Cypress_QSPI_ErasePlan *plan);
+HAL_StatusTypeDef Cypress_QSPI_ParameterErase(QSPI_HandleTypeDef *hqspi, uint32_t address);
+HAL_StatusTypeDef Cypress_QSPI_ParameterErase_IT(QSPI_HandleTypeDef *hqspi, uint32_t address);
 HAL_StatusTypeDef Cypress_QSPI_BulkErase(QSPI_HandleTypeDef *hqspi);
 HAL_StatusTypeDef Cypress_QSPI_BulkErase_IT(QSPI_HandleTypeDef *hqspi);
+HAL_StatusTypeDef Cypress_QSPI_ProgramSuspend(QSPI_HandleTypeDef *hqspi);
+HAL_StatusTypeDef Cypress_QSPI_ProgramResume(QSPI_HandleTypeDef *hqspi);
+HAL_StatusTypeDef Cypress_QSPI_ReadQuadDuringProgram(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count);
+HAL_StatusTypeDef Cypress_QSPI_EraseSuspend(QSPI_HandleTypeDef *hqspi);
+HAL_StatusTypeDef Cypress_QSPI_EraseResume(QSPI_HandleTypeDef *hqspi);
+#if (USE_HAL_QSPI_REGISTER_CALLBACKS == 1)
+HAL_StatusTypeDef Cypress_QSPI_ManagedErase(QSPI_HandleTypeDef *hqspi, uint32_t address, Cypress_QSPI_CompleteCallback callback);
+HAL_StatusTypeDef Cypress_QSPI_EraseRange(QSPI_HandleTypeDef *hqspi, uint32_t start, uint32_t length, Cypress_QSPI_ErasePlan *plan,
+                                          Cypress_QSPI_ProgressCallback progress, Cypress_QSPI_CompleteCallback callback);
+HAL_StatusTypeDef Cypress_QSPI_ManagedRead(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count);
+HAL_StatusTypeDef Cypress_QSPI_ManagedProgram(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count);
+HAL_StatusTypeDef Cypress_QSPI_ServiceManagedErase(QSPI_HandleTypeDef *hqspi);
+HAL_StatusTypeDef Cypress_QSPI_GetManagedEraseStatus(void);
+void Cypress_QSPI_GetEraseStats(Cypress_QSPI_EraseStats *stats);
+void Cypress_QSPI_ResetEraseStats(void);
+HAL_StatusTypeDef Cypress_QSPI_PoolInit(uint32_t start, uint32_t count, uint32_t target, uint32_t lowWatermark, Cypress_QSPI_PoolCallback callback);
+HAL_StatusTypeDef Cypress_QSPI_PoolService(QSPI_HandleTypeDef *hqspi);
+HAL_StatusTypeDef Cypress_QSPI_PoolClaim(uint32_t *address);
+HAL_StatusTypeDef Cypress_QSPI_PoolRelease(uint32_t address);
+void Cypress_QSPI_GetPoolStats(Cypress_QSPI_PoolStats *stats);
+#endif
 
 HAL_StatusTypeDef Cypress_QSPI_Read(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count);
 HAL_StatusTypeDef Cypress_QSPI_Read_IT(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count);
@@ -41,19 +223,90 @@ HAL_StatusTypeDef Cypress_QSPI_ReadQuad(QSPI_HandleTypeDef *hqspi, uint32_t addr
 HAL_StatusTypeDef Cypress_QSPI_ReadQuadAlt(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count);
 HAL_StatusTypeDef Cypress_QSPI_ReadQuad_IT(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count);
 HAL_StatusTypeDef Cypress_QSPI_ReadQuad_DMA(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count);
+HAL_StatusTypeDef Cypress_QSPI_ReadDual(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count);
+HAL_StatusTypeDef Cypress_QSPI_ReadDual_IT(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count);
+HAL_StatusTypeDef Cypress_QSPI_ReadDual_DMA(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count);
+HAL_StatusTypeDef Cypress_QSPI_ReadDualIO(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count);
+HAL_StatusTypeDef Cypress_QSPI_ReadDualIO_IT(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count);
+HAL_StatusTypeDef Cypress_QSPI_ReadDualIO_DMA(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count);
+HAL_StatusTypeDef Cypress_QSPI_ReadDDR(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count);
+HAL_StatusTypeDef Cypress_QSPI_ReadDDR_IT(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count);
+HAL_StatusTypeDef Cypress_QSPI_ReadDDR_DMA(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count);
+HAL_StatusTypeDef Cypress_QSPI_ReadQuadDDR(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count);
+HAL_StatusTypeDef Cypress_QSPI_ReadQuadDDR_IT(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count);
+HAL_StatusTypeDef Cypress_QSPI_ReadQuadDDR_DMA(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count);
+HAL_StatusTypeDef Cypress_QSPI_EnableMemoryMapped(QSPI_HandleTypeDef *hqspi);
+HAL_StatusTypeDef Cypress_QSPI_DisableMemoryMapped(QSPI_HandleTypeDef *hqspi);
+HAL_StatusTypeDef Cypress_QSPI_BeginContinuousRead(QSPI_HandleTypeDef *hqspi);
+HAL_StatusTypeDef Cypress_QSPI_ReadContinuous(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count);
+HAL_StatusTypeDef Cypress_QSPI_EndContinuousRead(QSPI_HandleTypeDef *hqspi);
+#if (USE_HAL_QSPI_REGISTER_CALLBACKS == 1)
+HAL_StatusTypeDef Cypress_QSPI_ReadStream(QSPI_HandleTypeDef *hqspi, uint32_t address, uint32_t count, uint8_t *buffer0, uint8_t *buffer1, uint32_t chunkSize, Cypress_QSPI_ChunkCallback callback);
+HAL_StatusTypeDef Cypress_QSPI_GetStreamStatus(void);
+HAL_StatusTypeDef Cypress_QSPI_AbortStream(QSPI_HandleTypeDef *hqspi);
+HAL_StatusTypeDef Cypress_QSPI_ReadV(QSPI_HandleTypeDef *hqspi, const Cypress_QSPI_ReadDescriptor *vector, uint32_t length, Cypress_QSPI_CompleteCallback callback);
+HAL_StatusTypeDef Cypress_QSPI_GetReadVStatus(void);
+#endif
+// CYPRESS_CACHE_LINES defaults to 0 further down, so only a definition made before this header enables the cache
+#if defined(CYPRESS_CACHE_LINES) && (CYPRESS_CACHE_LINES > 0)
+HAL_StatusTypeDef Cypress_QSPI_ReadQuadCached(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count);
+HAL_StatusTypeDef Cypress_QSPI_ReadQuadCached_DMA(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count);
+void Cypress_QSPI_CacheInvalidate(uint32_t address, uint32_t count);
+void Cypress_QSPI_CacheInvalidateAll(void);
+void Cypress_QSPI_GetCacheStats(Cypress_QSPI_CacheStats *stats);
+void Cypress_QSPI_ResetCacheStats(void);
+#endif
+#if defined(CYPRESS_PREFETCH_SIZE) && (CYPRESS_PREFETCH_SIZE > 0)
+HAL_StatusTypeDef Cypress_QSPI_ReadQuadPrefetch(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count);
+HAL_StatusTypeDef Cypress_QSPI_PrefetchInvalidate(QSPI_HandleTypeDef *hqspi);
+void Cypress_QSPI_GetPrefetchStats(Cypress_QSPI_PrefetchStats *stats);
+void Cypress_QSPI_ResetPrefetchStats(void);
+#endif
 HAL_StatusTypeDef Cypress_QSPI_Program(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count);
 HAL_StatusTypeDef Cypress_QSPI_Program_IT(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count);
 HAL_StatusTypeDef Cypress_QSPI_Program_DMA(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count);
 HAL_StatusTypeDef Cypress_QSPI_ProgramQuad(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count);
 HAL_StatusTypeDef Cypress_QSPI_ProgramQuad_IT(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count);
 HAL_StatusTypeDef Cypress_QSPI_ProgramQuad_DMA(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count);
+HAL_StatusTypeDef Cypress_QSPI_ProgramRange(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count);
+HAL_StatusTypeDef Cypress_QSPI_ProgramCombined(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count);
+HAL_StatusTypeDef Cypress_QSPI_Flush(QSPI_HandleTypeDef *hqspi);
+HAL_StatusTypeDef Cypress_QSPI_FlushIfIdle(QSPI_HandleTypeDef *hqspi);
+HAL_StatusTypeDef Cypress_QSPI_UpdateRange(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count, Cypress_QSPI_UpdateStats *stats);
+HAL_StatusTypeDef Cypress_QSPI_UpdateInPlace(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count, Cypress_QSPI_UpdateStats *stats);
+#if (USE_HAL_QSPI_REGISTER_CALLBACKS == 1)
+HAL_StatusTypeDef Cypress_QSPI_ProgramRange_DMA(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *src, uint32_t count, Cypress_QSPI_CompleteCallback callback);
+HAL_StatusTypeDef Cypress_QSPI_GetProgramRangeStatus(void);
+#endif
 
 HAL_StatusTypeDef Cypress_QSPI_ModeBitReset(QSPI_HandleTypeDef *hqspi);
 HAL_StatusTypeDef Cypress_QSPI_Reset(QSPI_HandleTypeDef *hqspi);
 HAL_StatusTypeDef Cypress_QSPI_ResetConfiguration(QSPI_HandleTypeDef *hqspi);
+HAL_StatusTypeDef Cypress_QSPI_ComputeTimingProfile(uint32_t kernelClock, uint32_t prescaler, Cypress_QSPI_TimingProfile *profile);
+HAL_StatusTypeDef Cypress_QSPI_ApplyTimingProfile(QSPI_HandleTypeDef *hqspi, const Cypress_QSPI_TimingProfile *profile);
+HAL_StatusTypeDef Cypress_QSPI_UpdateTimingProfile(QSPI_HandleTypeDef *hqspi);
+void Cypress_QSPI_GetTimingProfile(QSPI_HandleTypeDef *hqspi, Cypress_QSPI_TimingProfile *profile);
+HAL_StatusTypeDef Cypress_QSPI_CalibrateTiming(QSPI_HandleTypeDef *hqspi, uint32_t address, uint32_t minPrescaler, Cypress_QSPI_TimingProfile *profile);
 void Cypress_QSPI_DisableWP(GPIO_TypeDef *GPIO_Port, uint32_t GPIO_Pin);
 void Cypress_QSPI_ResetWP(GPIO_TypeDef *GPIO_Port, uint32_t GPIO_Pin);
 
+HAL_StatusTypeDef Cypress_QSPI_DeviceInit(Cypress_QSPI_Device *dev, QSPI_HandleTypeDef *hqspi);
+HAL_StatusTypeDef Cypress_QSPI_DevRefresh(Cypress_QSPI_Device *dev);
+HAL_StatusTypeDef Cypress_QSPI_DevWriteRegisters(Cypress_QSPI_Device *dev, uint8_t sReg, uint8_t cReg);
+HAL_StatusTypeDef Cypress_QSPI_DevWriteSR1(Cypress_QSPI_Device *dev, uint8_t sReg);
+HAL_StatusTypeDef Cypress_QSPI_DevWriteCR(Cypress_QSPI_Device *dev, uint8_t cReg);
+HAL_StatusTypeDef Cypress_QSPI_DevEnableQuad(Cypress_QSPI_Device *dev);
+uint8_t Cypress_QSPI_DevIsQuadEnabled(const Cypress_QSPI_Device *dev);
+HAL_StatusTypeDef Cypress_QSPI_DevApplyTimingProfile(Cypress_QSPI_Device *dev, const Cypress_QSPI_TimingProfile *profile);
+void Cypress_QSPI_DevGetEraseBlock(const Cypress_QSPI_Device *dev, uint32_t *address, uint32_t *size);
+HAL_StatusTypeDef Cypress_QSPI_DevEraseBlock(Cypress_QSPI_Device *dev, uint32_t address);
+HAL_StatusTypeDef Cypress_QSPI_DevBulkErase(Cypress_QSPI_Device *dev);
+HAL_StatusTypeDef Cypress_QSPI_DevProgramRange(Cypress_QSPI_Device *dev, uint32_t address, uint8_t *src, uint32_t count);
+HAL_StatusTypeDef Cypress_QSPI_ReadID(QSPI_HandleTypeDef *hqspi, uint8_t *dest, uint32_t count);
+HAL_StatusTypeDef Cypress_QSPI_ReadSFDP(QSPI_HandleTypeDef *hqspi, uint32_t address, uint8_t *dest, uint32_t count);
+HAL_StatusTypeDef Cypress_QSPI_DeviceProbe(Cypress_QSPI_Device *dev, QSPI_HandleTypeDef *hqspi);
+HAL_StatusTypeDef Cypress_QSPI_DevRead(Cypress_QSPI_Device *dev, uint32_t address, uint8_t *dest, uint32_t count);
+
 /* FL-S series Commands */
 /* Reset Operations */
 #define SOFTWARE_RESET_CMD                    0xF0
@@ -123,6 +376,9 @@ void Cypress_QSPI_ResetWP(GPIO_TypeDef *GPIO_Port, uint32_t GPIO_Pin);
 #define SECTOR_ERASE_CMD                      0xD8
 #define SECTOR_ERASE_4_BYTE_ADDR_CMD          0xDC
 
+#define PARAM_4K_ERASE_CMD                    0x20
+#define PARAM_4K_ERASE_4_BYTE_ADDR_CMD        0x21
+
 #define BULK_ERASE_CMD                        0x60
 #define BULK_ERASE_ALTERNATE_CMD              0xC7
 
@@ -169,6 +425,7 @@ void Cypress_QSPI_ResetWP(GPIO_TypeDef *GPIO_Port, uint32_t GPIO_Pin);
 /* Configuration Register CR1 */
 #define CR1_FREEZE                            ((uint8_t)0x01)      /*!< Block protection and OTP locked */
 #define CR1_QUAD                              ((uint8_t)0x02)      /*!< Quad mode enable */
+#define CR1_TBPARM                            ((uint8_t)0x04)      /*!< Parameter sectors at top (OTP) */
 #define CR1_BPNV                              ((uint8_t)0x08)      /*!< BP2-0 bits of Status Reg are volatile */
 #define CR1_TBPROT                            ((uint8_t)0x20)      /*!< BPstarts at bottom */
 #define CR1_LC_MASK                           ((uint8_t)0xC0)      /*!< Latency Code mask */
@@ -197,7 +454,9 @@ void Cypress_QSPI_ResetWP(GPIO_TypeDef *GPIO_Port, uint32_t GPIO_Pin);
 
 /**
 * @defgroup    QSPI_DUMMY QSPI Dummy clock configuration
-* @brief   Dummy cycles for SDR, High Performance
+* @brief   Default dummy cycles for SDR, High Performance
+* @note    These are only the defaults used until \ref Cypress_QSPI_ApplyTimingProfile is called.
+*          \ref Cypress_QSPI_UpdateTimingProfile computes them from the actual QSPI clock at runtime instead.
 * @pre     Define QSPI_DUMMY_{50 | 80 | 90 | 104} based on the QSPI peripheral clock speed
 * @pre     ex. for a peripheral speed of < 50 MHz, use `#define QSPI_DUMMY_50`
 * @pre     This should be set in a global location
@@ -207,8 +466,11 @@ void Cypress_QSPI_ResetWP(GPIO_TypeDef *GPIO_Port, uint32_t GPIO_Pin);
 * @retval  CYPRESS_DUMMY_CLOCK_CYCLES_READ_DUALIO: dummy clock cycles for DUALIO reads
 * @retval  CYPRESS_DUMMY_CLOCK_CYCLES_READ_QUAD: dummy clock cycles for QUAD reads
 * @retval  CYPRESS_DUMMY_CLOCK_CYCLES_READ_QUADIO: dummy clock cycles for QUADIO reads
+* @retval  CYPRESS_DUMMY_CLOCK_CYCLES_FASTREAD_DDR: dummy clock cycles for DDR FASTREAD reads
+* @retval  CYPRESS_DUMMY_CLOCK_CYCLES_READ_QUADIO_DDR: dummy clock cycles for DDR QUADIO reads
 * @retval  CYPRESS_DUMMY_LC: Latency code for given speed
 * @post    User must set CYPRESS_DUMMY_LC in CR1 for any read operations
+* @note    DDR reads are limited to 80 MHz regardless of the SDR frequency selected here
 */
 
 #if defined(QSPI_DUMMY_50)
@@ -219,46 +481,232 @@ void Cypress_QSPI_ResetWP(GPIO_TypeDef *GPIO_Port, uint32_t GPIO_Pin);
 #define CYPRESS_DUMMY_CLOCK_CYCLES_READ_DUALIO      4
 #define CYPRESS_DUMMY_CLOCK_CYCLES_READ_QUAD        0
 #define CYPRESS_DUMMY_CLOCK_CYCLES_READ_QUADIO      1
+#define CYPRESS_DUMMY_CLOCK_CYCLES_FASTREAD_DDR     1
+#define CYPRESS_DUMMY_CLOCK_CYCLES_READ_QUADIO_DDR  3
 #define CYPRESS_DUMMY_LC                            (CR1_LC3)
 
 #elif defined(QSPI_DUMMY_90)
 // Freq <= 90MHz
-#define CYPRESS_DUMMY_CLOCK_CYCLES_READ             NULL
+#define CYPRESS_DUMMY_CLOCK_CYCLES_READ             0
 #define CYPRESS_DUMMY_CLOCK_CYCLES_FASTREAD         8
 #define CYPRESS_DUMMY_CLOCK_CYCLES_READ_DUAL        8
 #define CYPRESS_DUMMY_CLOCK_CYCLES_READ_DUALIO      8
 #define CYPRESS_DUMMY_CLOCK_CYCLES_READ_QUAD        5
 #define CYPRESS_DUMMY_CLOCK_CYCLES_READ_QUADIO      4
+#define CYPRESS_DUMMY_CLOCK_CYCLES_FASTREAD_DDR     4
+#define CYPRESS_DUMMY_CLOCK_CYCLES_READ_QUADIO_DDR  7
 #define CYPRESS_DUMMY_LC                            (CR1_LC1)
 
 #elif defined(QSPI_DUMMY_104)
 // Freq <= 104MHz
-#define CYPRESS_DUMMY_CLOCK_CYCLES_READ             NULL
+#define CYPRESS_DUMMY_CLOCK_CYCLES_READ             0
 #define CYPRESS_DUMMY_CLOCK_CYCLES_FASTREAD         8
 #define CYPRESS_DUMMY_CLOCK_CYCLES_READ_DUAL        8
 #define CYPRESS_DUMMY_CLOCK_CYCLES_READ_DUALIO      8
 #define CYPRESS_DUMMY_CLOCK_CYCLES_READ_QUAD        6
 #define CYPRESS_DUMMY_CLOCK_CYCLES_READ_QUADIO      5
+#define CYPRESS_DUMMY_CLOCK_CYCLES_FASTREAD_DDR     5
+#define CYPRESS_DUMMY_CLOCK_CYCLES_READ_QUADIO_DDR  8
 #define CYPRESS_DUMMY_LC                            (CR1_LC2)
 
 #else
 // Freq <= 80MHz, default chip configuration
-#define CYPRESS_DUMMY_CLOCK_CYCLES_READ             NULL
+#define CYPRESS_DUMMY_CLOCK_CYCLES_READ             0
 #define CYPRESS_DUMMY_CLOCK_CYCLES_FASTREAD         8
 #define CYPRESS_DUMMY_CLOCK_CYCLES_READ_DUAL        8
 #define CYPRESS_DUMMY_CLOCK_CYCLES_READ_DUALIO      8
 #define CYPRESS_DUMMY_CLOCK_CYCLES_READ_QUAD        4
 #define CYPRESS_DUMMY_CLOCK_CYCLES_READ_QUADIO      4
+#define CYPRESS_DUMMY_CLOCK_CYCLES_FASTREAD_DDR     2
+#define CYPRESS_DUMMY_CLOCK_CYCLES_READ_QUADIO_DDR  6
 #define CYPRESS_DUMMY_LC                            (CR1_LC0)
 
 #endif // End QSPI_DUMMY
 
+/* DDR data hold */
+// Delays the data output by 1/4 clock in DDR mode, as recommended for FL-S parts
+#ifndef CYPRESS_DDR_HOLD_HALF_CYCLE
+#define CYPRESS_DDR_HOLD_HALF_CYCLE                 QSPI_DDR_HHC_HALF_CLK_DELAY
+#endif
+
+/* Continuous read mode */
+// Mode bits of 0xAx on a Quad I/O read keep the flash waiting for the next address without an instruction
+#define CYPRESS_CONTINUOUS_READ_MODE          ((uint8_t)0xA0)
+
+/* Memory-mapped window */
+// Flash address 0 appears here once Cypress_QSPI_EnableMemoryMapped has been called
+#define CYPRESS_MEMORY_MAPPED_ADDR            ((uint32_t)0x90000000)
+
+/* Timing calibration */
+// Pattern loaded into the DLR; it should contain both 0-1 and 1-0 transitions
+#define CYPRESS_DLP_PATTERN                   ((uint8_t)0x34)
+// Highest SCK the FL-S is rated for, with latency code 2
+#define CYPRESS_MAX_FREQUENCY                 104000000
+// Reads that must all succeed for a setting to be accepted
+#define CYPRESS_CALIBRATION_PASSES            16
+// Bytes read from the calibration address and compared against the reference
+#define CYPRESS_CALIBRATION_SIZE              64
+
+/* Flash geometry */
+// Uniform sector size of the S25FL512S
+#ifndef CYPRESS_SECTOR_SIZE
+#define CYPRESS_SECTOR_SIZE                   ((uint32_t)0x40000)
+#endif
+// Page program buffer of the S25FL512S; the 128S and 256S only have 256 bytes
+#ifndef CYPRESS_PAGE_SIZE
+#define CYPRESS_PAGE_SIZE                     ((uint32_t)512)
+#endif
+// Array size of the S25FL512S in bytes
+#ifndef CYPRESS_FLASH_SIZE
+#define CYPRESS_FLASH_SIZE                    ((uint32_t)0x4000000)
+#endif
+// 4 KB parameter sectors, at the top or bottom per CR1_TBPARM
+// The 512S has none; set the count to 32 for a 128S or 256S with 64 KB sectors
+#ifndef CYPRESS_PARAM_SECTOR_COUNT
+#define CYPRESS_PARAM_SECTOR_COUNT            0
+#endif
+#define CYPRESS_PARAM_SECTOR_SIZE             ((uint32_t)0x1000)
+
+/* Device capabilities, see Cypress_QSPI_Device */
+#define CYPRESS_CAP_DUAL                      ((uint32_t)0x01)     /*!< Dual output reads (1-1-2) */
+#define CYPRESS_CAP_QUAD                      ((uint32_t)0x02)     /*!< Quad output reads (1-1-4) and Quad page program */
+#define CYPRESS_CAP_DDR                       ((uint32_t)0x04)     /*!< DDR reads */
+#define CYPRESS_CAP_PARAM_SECTORS             ((uint32_t)0x08)     /*!< 4 KB parameter sectors */
+#define CYPRESS_CAP_SUSPEND                   ((uint32_t)0x10)     /*!< Program and erase suspend */
+#define CYPRESS_CAP_DUAL_IO                   ((uint32_t)0x20)     /*!< Dual I/O reads (1-2-2) */
+#define CYPRESS_CAP_QUAD_IO                   ((uint32_t)0x40)     /*!< Quad I/O reads (1-4-4) */
+
+/* Read modes, see Cypress_QSPI_DevRead */
+#define CYPRESS_READ                          ((uint8_t)0)         /*!< \ref Cypress_QSPI_Read */
+#define CYPRESS_READ_DUAL                     ((uint8_t)1)         /*!< \ref Cypress_QSPI_ReadDual */
+#define CYPRESS_READ_DUAL_IO                  ((uint8_t)2)         /*!< \ref Cypress_QSPI_ReadDualIO */
+#define CYPRESS_READ_QUAD                     ((uint8_t)3)         /*!< \ref Cypress_QSPI_ReadQuadAlt */
+#define CYPRESS_READ_QUAD_IO                  ((uint8_t)4)         /*!< \ref Cypress_QSPI_ReadQuad */
+#define CYPRESS_READ_QUAD_IO_DDR              ((uint8_t)5)         /*!< \ref Cypress_QSPI_ReadQuadDDR */
+
+/* Identification */
+#define CYPRESS_MANUFACTURER_ID               ((uint8_t)0x01)
+// Bytes of the ID-CFI block read by Cypress_QSPI_DeviceProbe, enough for the first four erase regions
+#define CYPRESS_ID_CFI_SIZE                   0x40
+// "SFDP", little endian
+#define CYPRESS_SFDP_SIGNATURE                ((uint32_t)0x50444653)
+// Highest SCK for DDR reads; above it Cypress_QSPI_DeviceProbe picks an SDR mode
+#ifndef CYPRESS_DDR_MAX_FREQUENCY
+#define CYPRESS_DDR_MAX_FREQUENCY             80000000
+#endif
+
+/**
+* @defgroup QSPI_CACHE Read cache
+* @brief   Set-associative LRU cache used by \ref Cypress_QSPI_ReadQuadCached
+* @note    Disabled by default. Define CYPRESS_CACHE_LINES as a non-zero multiple of CYPRESS_CACHE_WAYS to enable it;
+*          the cache then takes CYPRESS_CACHE_LINES * CYPRESS_CACHE_LINE_SIZE bytes of RAM.
+* @note    Program and erase functions invalidate the lines they overlap
+* @{
+*/
+#ifndef CYPRESS_CACHE_LINES
+#define CYPRESS_CACHE_LINES                   0
+#endif
+#ifndef CYPRESS_CACHE_WAYS
+#define CYPRESS_CACHE_WAYS                    4
+#endif
+#ifndef CYPRESS_CACHE_LINE_SIZE
+#define CYPRESS_CACHE_LINE_SIZE               64
+#endif
+
+#if (CYPRESS_CACHE_LINES > 0) && ((CYPRESS_CACHE_LINES % CYPRESS_CACHE_WAYS) != 0)
+#error "CYPRESS_CACHE_LINES must be a multiple of CYPRESS_CACHE_WAYS"
+#endif
+#if (CYPRESS_CACHE_LINES > 0) && ((CYPRESS_CACHE_LINE_SIZE & (CYPRESS_CACHE_LINE_SIZE - 1)) != 0)
+#error "CYPRESS_CACHE_LINE_SIZE must be a power of two"
+#endif
+/** @} */
+
+/**
+* @defgroup QSPI_PREFETCH Read-ahead
+* @brief   Sequential read-ahead used by \ref Cypress_QSPI_ReadQuadPrefetch
+* @note    Disabled by default. Define CYPRESS_PREFETCH_SIZE as the largest prefetch in bytes to enable it;
+*          it must be a power of two multiple of CYPRESS_PREFETCH_MIN_BLOCK, and register callbacks must be enabled.
+* @note    The prefetch size starts at CYPRESS_PREFETCH_MIN_BLOCK, doubles when a sequential read outruns it
+*          and halves when a prefetched block is dropped unused
+* @{
+*/
+#ifndef CYPRESS_PREFETCH_SIZE
+#define CYPRESS_PREFETCH_SIZE                 0
+#endif
+#ifndef CYPRESS_PREFETCH_MIN_BLOCK
+#define CYPRESS_PREFETCH_MIN_BLOCK            256
+#endif
+
+#if (CYPRESS_PREFETCH_SIZE > 0) && (USE_HAL_QSPI_REGISTER_CALLBACKS != 1)
+#error "The read-ahead needs USE_HAL_QSPI_REGISTER_CALLBACKS"
+#endif
+#if (CYPRESS_PREFETCH_SIZE > 0) && (CYPRESS_PREFETCH_SIZE < CYPRESS_PREFETCH_MIN_BLOCK)
+#error "CYPRESS_PREFETCH_SIZE must be at least CYPRESS_PREFETCH_MIN_BLOCK"
+#endif
+#if (CYPRESS_PREFETCH_SIZE > 0) && (((CYPRESS_PREFETCH_SIZE % CYPRESS_PREFETCH_MIN_BLOCK) != 0) || \
+    (((CYPRESS_PREFETCH_SIZE / CYPRESS_PREFETCH_MIN_BLOCK) & ((CYPRESS_PREFETCH_SIZE / CYPRESS_PREFETCH_MIN_BLOCK) - 1)) != 0))
+#error "CYPRESS_PREFETCH_SIZE must be a power of two multiple of CYPRESS_PREFETCH_MIN_BLOCK"
+#endif
+/** @} */
+
+/**
+* @defgroup QSPI_WRITE_COMBINE Write combining
+* @brief   Page buffer used by \ref Cypress_QSPI_ProgramCombined
+* @note    Disabled by default. Define CYPRESS_WRITE_COMBINE as 1 to enable it; it takes about CYPRESS_PAGE_SIZE * 9 / 8
+*          bytes of RAM.
+* @{
+*/
+#ifndef CYPRESS_WRITE_COMBINE
+#define CYPRESS_WRITE_COMBINE                 0
+#endif
+// Idle time in ms after which Cypress_QSPI_FlushIfIdle writes the buffer out
+#ifndef CYPRESS_WRITE_COMBINE_TIMEOUT
+#define CYPRESS_WRITE_COMBINE_TIMEOUT         100
+#endif
+/** @} */
+
+/**
+* @defgroup QSPI_FAST_PATH Register fast path
+* @brief   Direct QUADSPI register access for \ref Cypress_QSPI_ReadSR1, \ref Cypress_QSPI_ReadSR2,
+*          \ref Cypress_QSPI_ReadCR and \ref Cypress_QSPI_WriteEnable
+* @note    Enabled by default. Define CYPRESS_REGISTER_FAST_PATH as 0 to send them through HAL_QSPI_Command instead.
+* @{
+*/
+#ifndef CYPRESS_REGISTER_FAST_PATH
+#define CYPRESS_REGISTER_FAST_PATH            1
+#endif
+// Status checks before a fast path transfer is given up; a one byte read at the slowest SCK takes far fewer
+#ifndef CYPRESS_FAST_PATH_SPINS
+#define CYPRESS_FAST_PATH_SPINS               10000
+#endif
+/** @} */
+
 /* Bulk erase timeouts */
 // These are required for erase function timeouts
 // For ease, these are the sizes for the 512MB unit
 // Presumably, this will have the longest erase times, so is a safe default for all sizes
 #define BULK_ERASE_MAX_TIME                   460000
 #define SECTOR_ERASE_MAX_TIME                 2600
+#define PARAM_SECTOR_ERASE_MAX_TIME           725
+#define WRITE_REGISTER_MAX_TIME               2000
+#define PAGE_PROGRAM_MAX_TIME                 5
+// Suspend latency is at most 40 us for a program and 45 us for an erase, rounded up to whole ticks
+#define SUSPEND_MAX_TIME                      2
+// Minimum ms an erase runs after starting or resuming before the erase manager suspends it again
+#ifndef CYPRESS_ERASE_MIN_RESUME_INTERVAL
+#define CYPRESS_ERASE_MIN_RESUME_INTERVAL     2
+#endif
+// Programs Cypress_QSPI_ManagedProgram can queue while an erase is running
+#ifndef CYPRESS_ERASE_PROGRAM_QUEUE
+#define CYPRESS_ERASE_PROGRAM_QUEUE           4
+#endif
+
+/* Typical times */
+// Only used for estimates by Cypress_QSPI_UpdateRange, Cypress_QSPI_UpdateInPlace and Cypress_QSPI_EraseRange
+#define BULK_ERASE_TYP_TIME                   103000
+#define SECTOR_ERASE_TYP_TIME                 520
+#define PARAM_SECTOR_ERASE_TYP_TIME           130
+#define PAGE_PROGRAM_TYP_TIME_US              340
 
 #endif /* INC_CYPRESSQSPI_H_ */
 
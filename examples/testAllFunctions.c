@@ -37,6 +37,20 @@ MDMA_HandleTypeDef hmdma_quadspi_fifo_th;
 // Volatile flags for callbacks
 __IO uint8_t CmdCplt, RxCplt, TxCplt, StatusMatch, TimeOut;
 
+// Streaming read buffers
+ALIGN_32BYTES(uint8_t streamBuffer[2][32]);
+uint8_t streamResult[64];
+uint32_t streamBase;
+
+// One sector image for the incremental update
+uint8_t updateImage[CYPRESS_SECTOR_SIZE];
+
+// Bytes erased so far by the range erase
+__IO uint32_t eraseDone;
+
+// Set when the pre-erase pool runs low
+__IO uint8_t PoolLow;
+
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
@@ -49,6 +63,9 @@ static void CPU_CACHE_Enable(void);
 void Assert_Error(void);
 uint8_t compareBuffers(uint8_t buf1[], uint8_t buf2[], uint8_t len);
 void initBuffer(uint8_t buf[], uint8_t len);
+void streamChunk(uint8_t *chunk, uint32_t address, uint32_t count);
+void eraseProgress(uint32_t done, uint32_t total);
+void poolLow(uint32_t erased);
 
 /* USER CODE END PFP */
 
@@ -409,6 +426,699 @@ int main(void)
         Assert_Error();
     }
 
+    // Memory-mapped reads
+    if (Cypress_QSPI_EnableMemoryMapped(&hqspi) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if (!compareBuffers(programString, (uint8_t *)(CYPRESS_MEMORY_MAPPED_ADDR + address), programStringLen)) {
+        Assert_Error();
+    }
+
+    if (Cypress_QSPI_DisableMemoryMapped(&hqspi) != HAL_OK) {
+        Error_Handler();
+    }
+
+    // Continuous read session, the second read skips the instruction
+    if (Cypress_QSPI_BeginContinuousRead(&hqspi) != HAL_OK) {
+        Error_Handler();
+    }
+
+    for (uint8_t i = 0; i < 2; i++) {
+        initBuffer(receptionBuffer, programStringLen);
+
+        if (Cypress_QSPI_ReadContinuous(&hqspi, address, receptionBuffer, programStringLen) != HAL_OK) {
+            Error_Handler();
+        }
+
+        if (!compareBuffers(programString, receptionBuffer, programStringLen)) {
+            Assert_Error();
+        }
+    }
+
+    if (Cypress_QSPI_EndContinuousRead(&hqspi) != HAL_OK) {
+        Error_Handler();
+    }
+
+    // DDR, blocking functions
+    initBuffer(receptionBuffer, programStringLen);
+
+    if (Cypress_QSPI_ReadDDR(&hqspi, address, receptionBuffer, programStringLen) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if (!compareBuffers(programString, receptionBuffer, programStringLen)) {
+        Assert_Error();
+    }
+
+    initBuffer(receptionBuffer, programStringLen);
+
+    if (Cypress_QSPI_ReadQuadDDR(&hqspi, address, receptionBuffer, programStringLen) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if (!compareBuffers(programString, receptionBuffer, programStringLen)) {
+        Assert_Error();
+    }
+
+    // Timing profile for the current clock
+    if (Cypress_QSPI_UpdateTimingProfile(&hqspi) != HAL_OK) {
+        Error_Handler();
+    }
+
+    initBuffer(receptionBuffer, programStringLen);
+
+    if (Cypress_QSPI_ReadQuadAlt(&hqspi, address, receptionBuffer, programStringLen) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if (!compareBuffers(programString, receptionBuffer, programStringLen)) {
+        Assert_Error();
+    }
+
+    // Timing calibration, restoring the original timing afterwards
+    Cypress_QSPI_TimingProfile originalTiming;
+    Cypress_QSPI_TimingProfile calibratedTiming;
+
+    // Fastest prescaler that keeps SCK within the flash rating for this clock tree
+    uint32_t minPrescaler = HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_QSPI) / CYPRESS_MAX_FREQUENCY;
+
+    Cypress_QSPI_GetTimingProfile(&hqspi, &originalTiming);
+
+    if (Cypress_QSPI_CalibrateTiming(&hqspi, address, minPrescaler, &calibratedTiming) != HAL_OK) {
+        Error_Handler();
+    }
+
+    initBuffer(receptionBuffer, programStringLen);
+
+    if (Cypress_QSPI_ReadQuad(&hqspi, address, receptionBuffer, programStringLen) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if (!compareBuffers(programString, receptionBuffer, programStringLen)) {
+        Assert_Error();
+    }
+
+    if (Cypress_QSPI_ApplyTimingProfile(&hqspi, &originalTiming) != HAL_OK) {
+        Error_Handler();
+    }
+
+    // Dual output and dual I/O reads
+    initBuffer(receptionBuffer, programStringLen);
+
+    if (Cypress_QSPI_ReadDual(&hqspi, address, receptionBuffer, programStringLen) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if (!compareBuffers(programString, receptionBuffer, programStringLen)) {
+        Assert_Error();
+    }
+
+    initBuffer(receptionBuffer, programStringLen);
+
+    if (Cypress_QSPI_ReadDualIO(&hqspi, address, receptionBuffer, programStringLen) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if (!compareBuffers(programString, receptionBuffer, programStringLen)) {
+        Assert_Error();
+    }
+
+#if (USE_HAL_QSPI_REGISTER_CALLBACKS == 1)
+    // Streaming read through two 32 byte buffers
+    initBuffer(streamResult, programStringLen);
+    streamBase = address;
+
+    if (Cypress_QSPI_ReadStream(&hqspi, address, programStringLen, streamBuffer[0], streamBuffer[1], 32, streamChunk) != HAL_OK) {
+        Error_Handler();
+    }
+
+    while (Cypress_QSPI_GetStreamStatus() == HAL_BUSY) {
+        // Wait for every chunk to be delivered
+    }
+
+    if (Cypress_QSPI_GetStreamStatus() != HAL_OK) {
+        Error_Handler();
+    }
+
+    if (!compareBuffers(programString, streamResult, programStringLen)) {
+        Assert_Error();
+    }
+
+    // Vectored read, split into pieces with an empty descriptor in between
+    initBuffer(receptionBuffer, programStringLen);
+    Cypress_QSPI_ReadDescriptor readVector[] = {
+        { address, receptionBuffer, 10 },
+        { address + 10, receptionBuffer + 10, 0 },
+        { address + 10, receptionBuffer + 10, programStringLen - 10 },
+    };
+
+    if (Cypress_QSPI_ReadV(&hqspi, readVector, COUNTOF(readVector), NULL) != HAL_OK) {
+        Error_Handler();
+    }
+
+    while (Cypress_QSPI_GetReadVStatus() == HAL_BUSY) {
+        // Wait for every descriptor to be read
+    }
+
+    if (Cypress_QSPI_GetReadVStatus() != HAL_OK) {
+        Error_Handler();
+    }
+
+    if (!compareBuffers(programString, receptionBuffer, programStringLen)) {
+        Assert_Error();
+    }
+#endif
+
+#if (CYPRESS_CACHE_LINES > 0)
+    // Cached reads, the second one must be served from the cache
+    Cypress_QSPI_CacheStats cacheStats;
+
+    Cypress_QSPI_CacheInvalidateAll();
+    Cypress_QSPI_ResetCacheStats();
+
+    for (uint8_t i = 0; i < 2; i++) {
+        initBuffer(receptionBuffer, programStringLen);
+
+        if (Cypress_QSPI_ReadQuadCached(&hqspi, address, receptionBuffer, programStringLen) != HAL_OK) {
+            Error_Handler();
+        }
+
+        if (!compareBuffers(programString, receptionBuffer, programStringLen)) {
+            Assert_Error();
+        }
+    }
+
+    Cypress_QSPI_GetCacheStats(&cacheStats);
+
+    if ((cacheStats.Hits == 0) || (cacheStats.Hits != cacheStats.Misses)) {
+        Assert_Error();
+    }
+#endif
+
+#if (CYPRESS_PREFETCH_SIZE > 0)
+    // Sequential reads in small pieces, the later ones must come from the read-ahead
+    Cypress_QSPI_PrefetchStats prefetchStats;
+
+    Cypress_QSPI_ResetPrefetchStats();
+    initBuffer(receptionBuffer, programStringLen);
+
+    for (uint8_t i = 0; i < programStringLen; i += 8) {
+        uint8_t len = ((programStringLen - i) < 8) ? (programStringLen - i) : 8;
+
+        if (Cypress_QSPI_ReadQuadPrefetch(&hqspi, address + i, receptionBuffer + i, len) != HAL_OK) {
+            Error_Handler();
+        }
+    }
+
+    if (Cypress_QSPI_PrefetchInvalidate(&hqspi) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if (!compareBuffers(programString, receptionBuffer, programStringLen)) {
+        Assert_Error();
+    }
+
+    Cypress_QSPI_GetPrefetchStats(&prefetchStats);
+
+    if (prefetchStats.Hits == 0) {
+        Assert_Error();
+    }
+#endif
+
+    // Range program across a page boundary
+    uint32_t rangeAddress = address + 8 * QSPI_PAGE_SIZE + CYPRESS_PAGE_SIZE - 20;
+    initBuffer(receptionBuffer, programStringLen);
+
+    if (Cypress_QSPI_ProgramRange(&hqspi, rangeAddress, programString, programStringLen) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if (Cypress_QSPI_ReadQuad(&hqspi, rangeAddress, receptionBuffer, programStringLen) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if (!compareBuffers(programString, receptionBuffer, programStringLen)) {
+        Assert_Error();
+    }
+
+#if (USE_HAL_QSPI_REGISTER_CALLBACKS == 1)
+    // Pipelined range program across a page boundary
+    rangeAddress += 2 * CYPRESS_PAGE_SIZE;
+    initBuffer(receptionBuffer, programStringLen);
+
+    if (Cypress_QSPI_ProgramRange_DMA(&hqspi, rangeAddress, programString, programStringLen, NULL) != HAL_OK) {
+        Error_Handler();
+    }
+
+    while (Cypress_QSPI_GetProgramRangeStatus() == HAL_BUSY) {
+        // Wait for every page to be programmed
+    }
+
+    if (Cypress_QSPI_GetProgramRangeStatus() != HAL_OK) {
+        Error_Handler();
+    }
+
+    if (Cypress_QSPI_ReadQuad(&hqspi, rangeAddress, receptionBuffer, programStringLen) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if (!compareBuffers(programString, receptionBuffer, programStringLen)) {
+        Assert_Error();
+    }
+#endif
+
+    // Incremental update of the second sector, the repeat must not erase anything
+    Cypress_QSPI_UpdateStats updateStats;
+
+    for (uint32_t i = 0; i < CYPRESS_SECTOR_SIZE; i++) {
+        updateImage[i] = 0xFF;
+    }
+
+    for (uint8_t i = 0; i < programStringLen; i++) {
+        updateImage[i] = programString[i];
+    }
+
+    for (uint8_t i = 0; i < 2; i++) {
+        if (Cypress_QSPI_UpdateRange(&hqspi, CYPRESS_SECTOR_SIZE, updateImage, CYPRESS_SECTOR_SIZE, &updateStats) != HAL_OK) {
+            Error_Handler();
+        }
+    }
+
+    if ((updateStats.SectorsSkipped != 1) || (updateStats.BytesWritten != 0)) {
+        Assert_Error();
+    }
+
+    initBuffer(receptionBuffer, programStringLen);
+
+    if (Cypress_QSPI_ReadQuad(&hqspi, CYPRESS_SECTOR_SIZE, receptionBuffer, programStringLen) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if (!compareBuffers(programString, receptionBuffer, programStringLen)) {
+        Assert_Error();
+    }
+
+    // In-place update that only clears bits, then one that would need an erase
+    uint8_t clearedByte = 0x00;
+    uint8_t setByte = 0xFF;
+
+    if (Cypress_QSPI_UpdateInPlace(&hqspi, CYPRESS_SECTOR_SIZE + programStringLen, &clearedByte, 1, &updateStats) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if ((updateStats.PagesProgrammed != 1) || (updateStats.SectorsErased != 0)) {
+        Assert_Error();
+    }
+
+    if (Cypress_QSPI_UpdateInPlace(&hqspi, CYPRESS_SECTOR_SIZE + programStringLen, &setByte, 1, &updateStats) != HAL_ERROR) {
+        Assert_Error();
+    }
+
+#if (CYPRESS_WRITE_COMBINE == 1)
+    // Small combined writes, read back before and after the flush
+    rangeAddress += 2 * CYPRESS_PAGE_SIZE;
+
+    for (uint8_t i = 0; i < programStringLen; i += 4) {
+        uint8_t len = ((programStringLen - i) < 4) ? (programStringLen - i) : 4;
+
+        if (Cypress_QSPI_ProgramCombined(&hqspi, rangeAddress + i, programString + i, len) != HAL_OK) {
+            Error_Handler();
+        }
+    }
+
+    for (uint8_t i = 0; i < 2; i++) {
+        initBuffer(receptionBuffer, programStringLen);
+
+        if (Cypress_QSPI_ReadQuad(&hqspi, rangeAddress, receptionBuffer, programStringLen) != HAL_OK) {
+            Error_Handler();
+        }
+
+        if (!compareBuffers(programString, receptionBuffer, programStringLen)) {
+            Assert_Error();
+        }
+
+        if (Cypress_QSPI_Flush(&hqspi) != HAL_OK) {
+            Error_Handler();
+        }
+    }
+#endif
+
+    // Read from another page while a program is in progress
+    rangeAddress += 2 * CYPRESS_PAGE_SIZE;
+    initBuffer(receptionBuffer, programStringLen);
+    TxCplt = 0;
+    StatusMatch = 0;
+
+    if (Cypress_QSPI_ProgramQuad_DMA(&hqspi, rangeAddress, programString, programStringLen) != HAL_OK) {
+        Error_Handler();
+    }
+
+    while (TxCplt == 0) {
+        // Wait for command to complete
+    }
+
+    TxCplt = 0;
+
+    if (Cypress_QSPI_WaitMemReady_IT(&hqspi) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if (Cypress_QSPI_ReadQuadDuringProgram(&hqspi, address, receptionBuffer, programStringLen) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if (!compareBuffers(programString, receptionBuffer, programStringLen)) {
+        Assert_Error();
+    }
+
+    while (StatusMatch == 0) {
+        // Wait for the resumed program to complete
+    }
+
+    StatusMatch = 0;
+
+#if (USE_HAL_QSPI_REGISTER_CALLBACKS == 1)
+    // Read while a sector erase is in progress, suspending it for the read
+    Cypress_QSPI_EraseStats eraseStats;
+
+    Cypress_QSPI_ResetEraseStats();
+
+    if (Cypress_QSPI_ManagedErase(&hqspi, 4 * CYPRESS_SECTOR_SIZE, NULL) != HAL_OK) {
+        Error_Handler();
+    }
+
+    initBuffer(receptionBuffer, programStringLen);
+
+    if (Cypress_QSPI_ManagedRead(&hqspi, address, receptionBuffer, programStringLen) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if (!compareBuffers(programString, receptionBuffer, programStringLen)) {
+        Assert_Error();
+    }
+
+    if (Cypress_QSPI_ManagedRead(&hqspi, 4 * CYPRESS_SECTOR_SIZE, receptionBuffer, programStringLen) != HAL_ERROR) {
+        Assert_Error();
+    }
+
+    while (Cypress_QSPI_GetManagedEraseStatus() == HAL_BUSY) {
+        // The erase only completes from the service call
+        if (Cypress_QSPI_ServiceManagedErase(&hqspi) == HAL_ERROR) {
+            Error_Handler();
+        }
+    }
+
+    if (Cypress_QSPI_GetManagedEraseStatus() != HAL_OK) {
+        Error_Handler();
+    }
+
+    Cypress_QSPI_GetEraseStats(&eraseStats);
+
+    if ((eraseStats.Erases != 1) || (eraseStats.Suspends != 1)) {
+        Assert_Error();
+    }
+#endif
+
+#if (USE_HAL_QSPI_REGISTER_CALLBACKS == 1)
+    // Program another sector while an erase is in progress
+    rangeAddress += 2 * CYPRESS_PAGE_SIZE;
+    Cypress_QSPI_ResetEraseStats();
+
+    if (Cypress_QSPI_ManagedErase(&hqspi, 4 * CYPRESS_SECTOR_SIZE, NULL) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if (Cypress_QSPI_ManagedProgram(&hqspi, rangeAddress, programString, programStringLen) != HAL_OK) {
+        Error_Handler();
+    }
+
+    // The queued program is done before the read, so the read must return it
+    initBuffer(receptionBuffer, programStringLen);
+
+    if (Cypress_QSPI_ManagedRead(&hqspi, rangeAddress, receptionBuffer, programStringLen) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if (!compareBuffers(programString, receptionBuffer, programStringLen)) {
+        Assert_Error();
+    }
+
+    // Programmed in a suspend by the service call, which also completes the erase
+    if (Cypress_QSPI_ManagedProgram(&hqspi, rangeAddress + programStringLen, programString, programStringLen) != HAL_OK) {
+        Error_Handler();
+    }
+
+    HAL_StatusTypeDef serviceStatus;
+
+    do {
+        serviceStatus = Cypress_QSPI_ServiceManagedErase(&hqspi);
+    } while ((serviceStatus == HAL_BUSY) || ((serviceStatus == HAL_OK) && (Cypress_QSPI_GetManagedEraseStatus() == HAL_BUSY)));
+
+    if ((serviceStatus != HAL_OK) || (Cypress_QSPI_GetManagedEraseStatus() != HAL_OK)) {
+        Error_Handler();
+    }
+
+    initBuffer(receptionBuffer, programStringLen);
+
+    if (Cypress_QSPI_ReadQuad(&hqspi, rangeAddress + programStringLen, receptionBuffer, programStringLen) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if (!compareBuffers(programString, receptionBuffer, programStringLen)) {
+        Assert_Error();
+    }
+
+    Cypress_QSPI_GetEraseStats(&eraseStats);
+
+    if ((eraseStats.Programs != 2) || (eraseStats.Suspends != 2)) {
+        Assert_Error();
+    }
+#endif
+
+    // 4 KB parameter sector erase, only where the part has parameter sectors
+    uint32_t eraseBlock = 0;
+    uint32_t eraseSize;
+
+    if (Cypress_QSPI_GetEraseBlock(&hqspi, &eraseBlock, &eraseSize) != HAL_OK) {
+        Error_Handler();
+    }
+
+#if (CYPRESS_PARAM_SECTOR_COUNT > 0)
+    if (eraseSize == CYPRESS_PARAM_SECTOR_SIZE) {
+        if (Cypress_QSPI_ProgramRange(&hqspi, eraseBlock, programString, programStringLen) != HAL_OK) {
+            Error_Handler();
+        }
+
+        if (Cypress_QSPI_ParameterErase(&hqspi, eraseBlock) != HAL_OK) {
+            Error_Handler();
+        }
+
+        if (Cypress_QSPI_ReadQuad(&hqspi, eraseBlock, receptionBuffer, programStringLen) != HAL_OK) {
+            Error_Handler();
+        }
+
+        for (uint8_t i = 0; i < programStringLen; i++) {
+            if (receptionBuffer[i] != 0xFF) {
+                Assert_Error();
+            }
+        }
+    }
+#else
+    if ((eraseSize != CYPRESS_SECTOR_SIZE) || (Cypress_QSPI_ParameterErase(&hqspi, 0) != HAL_ERROR)) {
+        Assert_Error();
+    }
+#endif
+
+#if (USE_HAL_QSPI_REGISTER_CALLBACKS == 1)
+    // Erase two sectors in the background, and refuse a range that splits a sector
+    Cypress_QSPI_ErasePlan erasePlan;
+
+    if (Cypress_QSPI_PlanEraseRange(&hqspi, 4 * CYPRESS_SECTOR_SIZE, CYPRESS_SECTOR_SIZE / 2, &erasePlan) != HAL_ERROR) {
+        Assert_Error();
+    }
+
+    eraseDone = 0;
+
+    if (Cypress_QSPI_EraseRange(&hqspi, 4 * CYPRESS_SECTOR_SIZE, 2 * CYPRESS_SECTOR_SIZE, &erasePlan, eraseProgress, NULL) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if ((erasePlan.SectorErases != 2) || (erasePlan.BulkErase != 0) || (erasePlan.EstimatedTime == 0)) {
+        Assert_Error();
+    }
+
+    while (Cypress_QSPI_GetManagedEraseStatus() == HAL_BUSY) {
+        // Checks each sector and starts the next one
+        if (Cypress_QSPI_ServiceManagedErase(&hqspi) == HAL_ERROR) {
+            Error_Handler();
+        }
+    }
+
+    if ((Cypress_QSPI_GetManagedEraseStatus() != HAL_OK) || (eraseDone != 2 * CYPRESS_SECTOR_SIZE)) {
+        Assert_Error();
+    }
+#endif
+
+#if (USE_HAL_QSPI_REGISTER_CALLBACKS == 1)
+    // Fill a pre-erase pool, then claim a sector and program it without erasing
+    Cypress_QSPI_PoolStats poolStats;
+    uint32_t poolSector;
+    HAL_StatusTypeDef poolStatus;
+
+    PoolLow = 0;
+
+    if (Cypress_QSPI_PoolInit(8 * CYPRESS_SECTOR_SIZE, 4, 2, 2, poolLow) != HAL_OK) {
+        Error_Handler();
+    }
+
+    do {
+        poolStatus = Cypress_QSPI_PoolService(&hqspi);
+    } while (poolStatus == HAL_BUSY);
+
+    if (poolStatus != HAL_OK) {
+        Error_Handler();
+    }
+
+    Cypress_QSPI_GetPoolStats(&poolStats);
+
+    if ((poolStats.Erased != 2) || (poolStats.Dirty != 2)) {
+        Assert_Error();
+    }
+
+    if (Cypress_QSPI_PoolClaim(&poolSector) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if (PoolLow != 1) {
+        Assert_Error();
+    }
+
+    if (Cypress_QSPI_ProgramRange(&hqspi, poolSector, programString, programStringLen) != HAL_OK) {
+        Error_Handler();
+    }
+
+    initBuffer(receptionBuffer, programStringLen);
+
+    if (Cypress_QSPI_ReadQuad(&hqspi, poolSector, receptionBuffer, programStringLen) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if (!compareBuffers(programString, receptionBuffer, programStringLen)) {
+        Assert_Error();
+    }
+
+    if (Cypress_QSPI_PoolRelease(poolSector) != HAL_OK) {
+        Error_Handler();
+    }
+
+    Cypress_QSPI_GetPoolStats(&poolStats);
+
+    if ((poolStats.Erased != 1) || (poolStats.InUse != 0) || (poolStats.Dirty != 3)) {
+        Assert_Error();
+    }
+#endif
+
+    // Device context, the second quad enable and the erase lookup must not touch the bus
+    Cypress_QSPI_Device device;
+    uint32_t deviceBlock = 5 * CYPRESS_SECTOR_SIZE + 0x123;
+    uint32_t deviceSize;
+    uint32_t plainBlock = deviceBlock;
+    uint32_t plainSize;
+
+    if (Cypress_QSPI_DeviceInit(&device, &hqspi) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if (Cypress_QSPI_DevEnableQuad(&device) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if (Cypress_QSPI_DevEnableQuad(&device) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if (!Cypress_QSPI_DevIsQuadEnabled(&device)) {
+        Assert_Error();
+    }
+
+    Cypress_QSPI_DevGetEraseBlock(&device, &deviceBlock, &deviceSize);
+
+    if (Cypress_QSPI_GetEraseBlock(&hqspi, &plainBlock, &plainSize) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if ((deviceBlock != plainBlock) || (deviceSize != plainSize)) {
+        Assert_Error();
+    }
+
+    // Erase the block, then program across a page boundary split at the page size of the context
+    uint32_t deviceAddress = deviceBlock + device.PageSize - 20;
+
+    if (Cypress_QSPI_DevEraseBlock(&device, deviceBlock) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if (Cypress_QSPI_DevProgramRange(&device, deviceAddress, programString, programStringLen) != HAL_OK) {
+        Error_Handler();
+    }
+
+    initBuffer(receptionBuffer, programStringLen);
+
+    if (Cypress_QSPI_ReadQuad(&hqspi, deviceAddress, receptionBuffer, programStringLen) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if (!compareBuffers(programString, receptionBuffer, programStringLen)) {
+        Assert_Error();
+    }
+
+    if (Cypress_QSPI_DevProgramRange(&device, device.FlashSize - 1, programString, 2) != HAL_ERROR) {
+        Assert_Error();
+    }
+
+    // Probe the part, it must match the S25FL512S constants and read back the device range in the picked mode
+    Cypress_QSPI_Device probed;
+    uint8_t probeBuffer[programStringLen];
+
+    if (Cypress_QSPI_DeviceProbe(&probed, &hqspi) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if ((probed.DeviceId != 0x0220) || (probed.FlashSize != CYPRESS_FLASH_SIZE) ||
+        (probed.SectorSize != CYPRESS_SECTOR_SIZE) || (probed.PageSize != CYPRESS_PAGE_SIZE)) {
+        Assert_Error();
+    }
+
+    if (probed.ReadMode == CYPRESS_READ) {
+        Assert_Error();
+    }
+
+    initBuffer(probeBuffer, programStringLen);
+
+    if (Cypress_QSPI_DevRead(&probed, deviceAddress, probeBuffer, programStringLen) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if (!compareBuffers(programString, probeBuffer, programStringLen)) {
+        Assert_Error();
+    }
+
+    // Erase it again with the probed layout and erase time
+    if (Cypress_QSPI_DevEraseBlock(&probed, deviceAddress) != HAL_OK) {
+        Error_Handler();
+    }
+
+    if (Cypress_QSPI_DevRead(&probed, deviceAddress, probeBuffer, programStringLen) != HAL_OK) {
+        Error_Handler();
+    }
+
+    for (uint8_t i = 0; i < programStringLen; i++) {
+        if (probeBuffer[i] != 0xFF) {
+            Assert_Error();
+        }
+    }
+
 
   /* USER CODE END 2 */
 
@@ -692,6 +1402,29 @@ void HAL_QSPI_StatusMatchCallback(QSPI_HandleTypeDef *hqspi)
     StatusMatch++;
 }
 
+/**
+* @brief Collects the chunks of a streaming read
+*/
+void streamChunk(uint8_t *chunk, uint32_t address, uint32_t count) {
+    for(uint32_t i = 0; i < count; i++) {
+        streamResult[address - streamBase + i] = chunk[i];
+    }
+}
+
+/**
+* @brief Records the progress of a range erase
+*/
+void eraseProgress(uint32_t done, uint32_t total) {
+    eraseDone = done;
+}
+
+/**
+* @brief Called when the pre-erase pool drops below its watermark
+*/
+void poolLow(uint32_t erased) {
+    PoolLow++;
+}
+
 /**
 * @brief Clears a buffer
 */